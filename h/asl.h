@@ -16,10 +16,18 @@
 /***************************************************************/
 
 extern int insertBlocked (int *semAdd, pcb_PTR p);
+extern int insertBlockedTimed (int *semAdd, pcb_PTR p, cpu_t deadline);
+extern int insertBlockedAny (int *semAdd[], int count, pcb_PTR p);
 extern pcb_PTR removeBlocked (int *semAdd);
 extern pcb_PTR outBlocked (pcb_PTR p);
+extern int *outBlockedAny (pcb_PTR p);
+extern pcb_PTR ownerBlocked (pcb_PTR p);
 extern pcb_PTR headBlocked (int *semAdd);
+extern pcb_PTR headTimeout ();
+extern int removeAllBlocked (int *semAdd, pcb_PTR *tp, int irqIndex, cpu_t irqTOD);
+extern int removeBlockedN (int *semAdd, pcb_PTR *tp, int n);
 extern void initASL ();
+extern void shrinkSemds ();
 
 /***************************************************************/
 
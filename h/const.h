@@ -62,6 +62,11 @@
 /* device common COMMAND codes */
 #define RESET			    0
 #define ACK				    1
+#define PRINTCHR		    2		/* printer PRINTCHR, terminal TRANSMITCHAR */
+
+/* printer and terminal transmitter */
+#define CHAR_SHIFT		    8		/* the character of a terminal TRANSMITCHAR command */
+#define CHAR_TRANSMITTED	5		/* terminal transmitter status after a character */
 
 /* Memory related constants */
 #define KSEG0           0x00000000
@@ -76,6 +81,7 @@
 #define UPROCSTARTADDR 0x800000B0
 #define USERSTACKTOP   0xC0000000
 #define KERNELSTACK    0x20001000
+#define STACK_RESERVE_SIZE (8 * PAGESIZE)  /* RAM kept below RAMTOP for the process stacks, out of the frame pool */
 
 /* Exceptions related constants */
 #define	PGFAULTEXCEPT	  0
@@ -143,6 +149,31 @@
 #define	SYS7_NUM			7
 #define	SYS8_NUM			8
 
+/* Nucleus SYSCALL extensions, negative so that they never collide with the Support Level (SYS9 and up) */
+#define	SETSCHED_NUM		-1		/* select the scheduling policy */
+#define	SETPRIO_NUM			-2		/* set the static priority of the caller */
+#define	SIGNALWAIT_NUM		-3		/* V(a1) then P(a2) in one trap */
+#define	MULTICALL_NUM		-4		/* run the a2 operations (sysop_t) of the array a1 in one trap */
+#define	TRYP_NUM			-5		/* P(a1) only if it does not block */
+#define	TIMEDP_NUM			-6		/* P(a1), giving up at the TOD a2 */
+#define	WAITANY_NUM			-7		/* P the first free of the a2 semaphores of the array a1 */
+#define	VN_NUM				-8		/* a2 V operations on a1 in one trap */
+#define	BROADCAST_NUM		-9		/* release every waiter of a1 */
+#define	IRQSTATS_NUM		-10		/* copy the interrupt statistics (irqstats_t) to a1, clear them if a2 */
+#define	TRACECTL_NUM		-11		/* set the trace mask to a1 */
+#define	SYSEXT_MIN_NUM		TRACECTL_NUM	/* lowest extension number in use */
+#define	WAITANY_MAX			16		/* most semaphores in a WAITANY set */
+
+/* Interrupt latency statistics (irqStats) */
+#define IRQ_LINES			8		/* per line, indexed by the line number (0 - 7) */
+#define IRQ_HIST_BUCKETS	16		/* bucket b counts [2^b, 2^(b+1)) microseconds, the last one everything longer */
+#define NO_IRQ				-1		/* p_irqIndex of a process not woken by an interrupt */
+
+/* State copy (moveStateHelper): a state_t is 35 words, copied by a fully unrolled body of
+STATE_COPY_WORDS words. STATE_WORDS must match it, checked in types.h once state_t is defined */
+#define STATE_WORDS			((int) (sizeof(state_t) / WORDLEN))
+#define STATE_COPY_WORDS	35
+
 /* Cause register BIT MASK constants */
 #define CAUSE_INT_MASK                  0x1F
 #define CAUSE_INT_SHIFT                 8
@@ -152,14 +183,22 @@
 #define EXC_CODE_MASK                   0x0000007C
 #define IP_LINE1_TIMER_BIT              0x00000200
 #define IP_LINE2_TIMER_BIT              0x00000400
+#define DEVICE_LINES_MASK               0xF8        /* lines 3-7 of the IP field, once shifted by CAUSE_INT_SHIFT */
 
 /* Clock Constants*/
 #define PLT_TIME_SLICE          5000
+#define MLFQ_TIME_SLICE(L)      (PLT_TIME_SLICE << (L))   /* quantum of level L: 5, 10, 20, 40 ms */
 #define INTERVAL_TIMER          100000
 #define INF_TIME		        0xFFFFFFFF
 
 /* Device Constants */
 #define MAX_DEVICE_COUNT        49
+#define DEVICE_WORK_SIZE        CLOCK_INDEX     /* deferred completions, one per device semaphore */
+/* Most devices served per line in one interrupt (disk, flash, network, printer, terminal),
+the others stay pending for the next one. DEVPERINT everywhere serves them all */
+#ifndef DEVICE_LINE_WEIGHTS
+#define DEVICE_LINE_WEIGHTS     { DEVPERINT, DEVPERINT, DEVPERINT, DEVPERINT, DEVPERINT }
+#endif
 #define CLOCK_INDEX             (MAX_DEVICE_COUNT - 1)
 #define BASE_LINE               3
 
@@ -171,9 +210,92 @@
 #define MAXINT 0x0FFFFFFF
 #define MAXPROC_SEM (MAXPROC + 2)
 
+/* Multi-level feedback queue Constants */
+#define MLFQ_LEVELS             4       /* number of ready queues */
+#define MLFQ_TOP_LEVEL          0       /* the level with the highest priority */
+#define MLFQ_BOOST_TICKS        10      /* pseudo-clock ticks between two priority boosts (1 second) */
+
+/* Static priority Constants */
+#define PRIO_LEVELS             8       /* number of priorities, 0 is the highest (at most 8, see prioBitmap) */
+#define PRIO_DEFAULT            4       /* priority of the first process */
+#define PRIO_INHERIT            0       /* SYS1 a3: the child gets the priority of its parent,
+                                           otherwise a3 is the priority of the child + 1 */
+
+/* Completely fair scheduler Constants */
+#define CFS_LATENCY             20000   /* every runnable process runs once in this period (20 ms) */
+#define CFS_MIN_GRANULARITY     2500    /* shortest quantum (2.5 ms) */
+#define CFS_NICE0_WEIGHT        1024    /* weight of priority PRIO_DEFAULT */
+#define CFS_WAKEUP_GRANULARITY  1000    /* a woken process preempts if it is this much less served (1 ms) */
+
+/* Scheduling policies (sched_class_t), selected at build time by SCHED_POLICY in the Makefile
+and at run time by the SETSCHED nucleus syscall */
+#define SCHED_RR                0       /* single round-robin queue */
+#define SCHED_MLFQ              1       /* multi-level feedback queue */
+#define SCHED_PRIORITY          2       /* static priority, round-robin inside a priority */
+#define SCHED_CFS               3       /* completely fair, least weighted virtual runtime first */
+#define SCHED_POLICY_COUNT      4
+#ifndef SCHED_DEFAULT_POLICY
+#define SCHED_DEFAULT_POLICY    SCHED_MLFQ
+#endif
+
+/* Scheduling modes (bit mask), selected at build time by SCHED_MODES in the Makefile
+and at run time by the SETSCHED nucleus syscall (a2) */
+#define SCHED_WAKEUP_PREEMPT    0x1     /* a woken process the policy prefers runs at once */
+#define SCHED_HANDOFF           0x2     /* a V that wakes a waiter gives it the rest of the caller's quantum */
+#define SCHED_MODES_ALL         (SCHED_WAKEUP_PREEMPT | SCHED_HANDOFF)
+#ifndef SCHED_DEFAULT_MODES
+#define SCHED_DEFAULT_MODES     0
+#endif
+
+/* Kernel event trace (trace.c): the event classes (bit mask), selected at build time by 
+TRACE_MASK in the Makefile and at run time by the TRACECTL nucleus syscall */
+#define TRACE_SWITCH            0x01    /* context switches */
+#define TRACE_SYSCALL           0x02    /* syscall entry and exit */
+#define TRACE_BLOCK             0x04    /* block and unblock on a semaphore */
+#define TRACE_INTERRUPT         0x08    /* interrupts and device acknowledges */
+#define TRACE_DEBUG             0x10    /* debugExceptionHandler calls */
+#define TRACE_ALL               0x1F
+#ifndef TRACE_DEFAULT_MASK
+#define TRACE_DEFAULT_MASK      0
+#endif
+
+/* Kernel event trace: the record events (trace_t t_event) */
+#define TRACE_EV_SWITCH         1       /* a0: p_time, a1: pc it resumes at */
+#define TRACE_EV_SYSCALL        2       /* a0: syscall number, a1 - a3: its arguments */
+#define TRACE_EV_SYSRET         3       /* a0: syscall number, a1: v0, a2: v1 */
+#define TRACE_EV_BLOCK          4       /* a0: semaphore address */
+#define TRACE_EV_UNBLOCK        5       /* a0: v0 it is woken with */
+#define TRACE_EV_INTERRUPT      6       /* a0: pending lines (Cause IP), a1: PLT left of the current process, a2: pc */
+#define TRACE_EV_DEVICE         7       /* a0: device semaphore index, a1: status */
+#define TRACE_EV_DEBUG          8       /* a0: key, a1 - a3: debugExceptionHandler parameters */
+#define TRACE_EV_LOST           9       /* a0: records overwritten before the drain read them (stream only) */
+#define TRACE_SIZE              256     /* records in the ring, must be a power of two */
+#define TRACE_ARGS              4
+
+/* Kernel event trace drain (traceDrain): the printer or terminal the records are streamed to, 
+selected at build time by TRACE_DRAIN and TRACE_DRAIN_DEV in the Makefile (line 0: no drain).
+The stream is a header (magic, version, words per record, TRACE_SIZE) then the records, 
+little-endian words as in memory (tools/tracedump decodes it) */
+#ifndef TRACE_DRAIN_LINE
+#define TRACE_DRAIN_LINE        0       /* 0, PRNTINT or TERMINT */
+#endif
+#ifndef TRACE_DRAIN_DEV
+#define TRACE_DRAIN_DEV         0
+#endif
+#if (TRACE_DRAIN_LINE != 0) && (TRACE_DRAIN_LINE != PRNTINT) && (TRACE_DRAIN_LINE != TERMINT)
+#error "TRACE_DRAIN must be 0 (no drain), 6 (printer) or 7 (terminal)"
+#endif
+#if (TRACE_DRAIN_DEV < 0) || (TRACE_DRAIN_DEV >= DEVPERINT)
+#error "TRACE_DRAIN_DEV must be a device number, 0 to 7"
+#endif
+#define TRACE_MAGIC             0x43525455  /* "UTRC" */
+#define TRACE_VERSION           1
+#define TRACE_RECORD_WORDS      ((int) (sizeof(trace_t) / WORDLEN))
+
 /* Semaphore Constants */
 #define SUCCESS_CONST		0
 #define ERROR_CONST			-1
+#define SEMD_HASH_SIZE		64		/* ASL hash buckets, must be a power of two */
 
 
 #endif
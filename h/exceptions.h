@@ -8,6 +8,9 @@ extern void systemTrapHandler();
 extern void tlbTrapHandler();
 extern void programTrapHandler();
 extern void addPigeonCurrentProcessHelper();
+extern void cancelWaitAnyHelper(pcb_PTR owner, int alive);
+extern pcb_PTR claimWaiterHelper(pcb_PTR this_pcb);
+extern void claimAllWaitersHelper(pcb_PTR *tp, pcb_PTR after, int count);
 extern void uTLB_RefillHandler();
 extern void exceptionHandler();
 
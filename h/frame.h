@@ -0,0 +1,24 @@
+#ifndef FRAME
+#define FRAME
+
+/************************* FRAME.H *****************************
+*
+*  The externals declaration file for the Kernel Frame Pool
+*    Module.
+*
+*  Editted by JaWeee
+*/
+
+#include "../h/types.h"
+
+/***************************************************************/
+/* The Kernel Frame Pool                                       */
+/***************************************************************/
+
+extern void initFrames (memaddr start, memaddr end);
+extern void *allocFrame ();
+extern void freeFrame (void *frame);
+
+/***************************************************************/
+
+#endif
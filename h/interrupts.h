@@ -4,6 +4,10 @@
 #include "../h/types.h"
 #include "../h/const.h"
 
+extern const unsigned char lowestBitTable[256];
+
 extern void interruptTrapHandler();
+extern int findInterruptDevice(unsigned int device_bit_map);
+extern void irqDispatchHelper(pcb_PTR process);
 
 #endif
\ No newline at end of file
@@ -17,7 +17,9 @@
 
 extern void freePcb (pcb_PTR p);
 extern pcb_PTR allocPcb ();
+extern void freeProcQ (pcb_PTR *tp);
 extern void initPcbs ();
+extern void shrinkPcbs ();
 
 /***************************************************************/
 /* The Process Queue                                           */
@@ -29,6 +31,9 @@ extern void insertProcQ (pcb_PTR *tp, pcb_PTR p);
 extern pcb_PTR removeProcQ (pcb_PTR *tp);
 extern pcb_PTR outProcQ (pcb_PTR *tp, pcb_PTR p);
 extern pcb_PTR headProcQ (pcb_PTR tp);
+extern void spliceProcQ (pcb_PTR *tp, pcb_PTR *tq);
+extern void concatProcQ (pcb_PTR *tp, pcb_PTR *tq);
+extern int removeProcQN (pcb_PTR *tp, pcb_PTR *tq, int n);
 
 /***************************************************************/
 /* The Child Queue                                             */
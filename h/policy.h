@@ -0,0 +1,13 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "../h/const.h"
+#include "../h/types.h"
+
+extern sched_class_PTR schedClass;
+extern int schedModes;
+
+extern void initSchedPolicy();
+extern int setSchedPolicy(int policy, int modes);
+
+#endif
@@ -5,7 +5,21 @@
 #include "../h/types.h"
 
 extern void switchContext(pcb_PTR nextProcess);
+extern void resumeContext();
 extern void scheduler();
 extern void moveStateHelper(state_PTR source_state, state_PTR destination_state);
 
+extern void insertReadyQueueHelper(pcb_PTR process);
+extern void insertAllReadyQueueHelper(pcb_PTR *tp);
+extern int wakeAllBlockedHelper(int *semaphore, int io_wait, int irq_index, cpu_t irq_TOD);
+extern int preemptsCurrentHelper(pcb_PTR process);
+extern void wakeProcessHelper(pcb_PTR process);
+extern void handoffProcessHelper(pcb_PTR process);
+extern pcb_PTR outReadyQueueHelper(pcb_PTR process);
+extern pcb_PTR removeReadyQueueHelper();
+extern void expiredProcessHelper(pcb_PTR process);
+extern void yieldProcessHelper(pcb_PTR process);
+extern void ioWaitProcessHelper(pcb_PTR process);
+extern void clockTickHelper();
+
 #endif
@@ -0,0 +1,27 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "../h/const.h"
+#include "../h/types.h"
+
+extern int traceMask;
+extern unsigned int traceNext;
+extern trace_t traceRing[TRACE_SIZE];
+extern int traceDrainActive;
+
+extern void traceHelper(int event, pcb_PTR process, int a0, int a1, int a2, int a3);
+extern void traceAllHelper(int event, pcb_PTR tp, pcb_PTR after);
+extern void traceDispatchHelper(pcb_PTR process, state_PTR state);
+extern void traceDrain();
+extern void traceDrainTickHelper();
+extern void initTraceDrain();
+
+/* Record an event if its class is on: a single branch when it is off */
+#define TRACE(class, event, process, a0, a1, a2, a3) \
+    do { \
+        if (traceMask & (class)) { \
+            traceHelper((event), (process), (int) (a0), (int) (a1), (int) (a2), (int) (a3)); \
+        } \
+    } while (0)
+
+#endif
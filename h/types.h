@@ -61,6 +61,10 @@ typedef struct state_t {
 
 } state_t, *state_PTR;
 
+/* moveStateHelper copies exactly STATE_COPY_WORDS words, unrolled by hand:
+   the build fails here (negative array size) if a state_t grows or shrinks */
+typedef char stateCopyWordsCheck[(STATE_WORDS == STATE_COPY_WORDS) ? 1 : -1];
+
 #define s_at s_reg[0]
 #define s_v0 s_reg[1]
 #define s_v1 s_reg[2]
@@ -140,12 +144,41 @@ typedef struct pcb_t {
     /* process status information */
     state_t p_s;   /* processor state */
     cpu_t p_time;  /* cpu time used by proc */
+    int p_level;   /* ready queue (MLFQ level) of proc */
+    int p_priority; /* static priority of proc, 0 is the highest */
+    int p_background; /* TRUE for a background process (the trace drain): pinned to the lowest MLFQ level */
+    cpu_t p_vruntime; /* weighted virtual runtime of proc (CFS) */
+    cpu_t p_vcharged; /* part of p_time already charged to p_vruntime */
+    struct pcb_t    *p_hChild, /* CFS heap: first child */
+                    *p_hSib,   /* CFS heap: right sibling */
+                    *p_hPrev;  /* CFS heap: left sibling, or parent for the first child */
 
     /* 
     * This pointer tells you on which semaphore (from the ASL) the process is waiting. 
     If the process is not blocked, p_semAdd is NULL.
     */
     int *p_semAdd; /* pointer to sema4 on which process blocked */
+    struct semd_t *p_semd; /* descriptor of that sema4 on the ASL */
+
+    /* timed wait (timedP): the ASL timeout list, sorted by deadline */
+    cpu_t p_deadline;         /* TOD at which the wait gives up */
+    struct pcb_t    *p_tmNext, /* next (later) timed waiter */
+                    *p_tmPrev; /* previous (earlier) timed waiter */
+
+    /* wait on any of a set (WAITANY): the owner is registered on each semaphore through a proxy pcb */
+    struct pcb_t    *p_waitOwner, /* proxy: the waiting process, NULL for a real process */
+                    *p_waitNext;  /* owner: first proxy, proxy: next proxy of the same owner */
+    int p_waitIndex;              /* proxy: index of its semaphore in the set, owner: the one signalled */
+
+    /* interrupt latency (irqStats): the device semaphore whose interrupt woke it, until it is dispatched */
+    int p_irqIndex;   /* NO_IRQ if none */
+    cpu_t p_irqTOD;   /* TOD of that interrupt entry */
+
+    /* kernel event trace: the syscall it is in (TRACE_SYSCALL), 0 if none */
+    int p_traceSys;
+
+    /* tail pointer of the process queue p currently lives on, NULL if none */
+    struct pcb_t **p_queue;
     
     /* support layer information */
     support_t *p_supportStruct; /* ptr to support struct */
@@ -156,6 +189,92 @@ typedef struct pcb_t {
 
 
 
+/*********************************************************************************************
+ * @brief Multicall Operation
+ * 
+ * This data structure is one operation of a MULTICALL batch: the nucleus runs the operations
+ * of an array in order in a single trap and writes the result of each one back
+*********************************************************************************************/
+
+typedef struct sysop_t {
+    int op_code;    /* SYS3_NUM (P), SYS4_NUM (V) or SYS6_NUM (get CPU time) */
+    int op_arg;     /* semaphore address for P and V */
+    int op_result;  /* SUCCESS_CONST, the CPU time for SYS6, ERROR_CONST for an unknown code */
+} sysop_t, *sysop_PTR;
+
+/*********************************************************************************************
+ * @brief Deferred Device Work
+ * 
+ * This data structure is one device completion recorded by the interrupt top half 
+ * (acknowledge only), for the bottom half to V the device semaphore and wake its waiter
+*********************************************************************************************/
+
+typedef struct devwork_t {
+    int w_index;    /* device semaphore index (semaphoreDevices) */
+    int w_status;   /* device status read before the acknowledge */
+} devwork_t;
+
+/*********************************************************************************************
+ * @brief Interrupt Latency Statistics
+ * 
+ * This data structure is the kernel statistics area of the interrupts: for each line and 
+ * each device semaphore, how long from the interrupt entry to the acknowledge, and to the 
+ * dispatch of the process the interrupt woke (IRQSTATS copies it out)
+*********************************************************************************************/
+
+typedef struct latstat_t {
+    unsigned int l_count;                   /* samples */
+    cpu_t l_total, l_min, l_max;            /* microseconds */
+    unsigned int l_hist[IRQ_HIST_BUCKETS];  /* log2 histogram of the samples */
+} latstat_t;
+
+typedef struct irqstats_t {
+    latstat_t st_lineAck[IRQ_LINES];                /* entry to acknowledge, per line */
+    latstat_t st_lineDispatch[IRQ_LINES];           /* entry to dispatch of the waiter, per line */
+    latstat_t st_deviceAck[MAX_DEVICE_COUNT];       /* entry to acknowledge, per device semaphore */
+    latstat_t st_deviceDispatch[MAX_DEVICE_COUNT];  /* entry to dispatch of the waiter, per device semaphore */
+} irqstats_t;
+
+/*********************************************************************************************
+ * @brief Trace Record
+ * 
+ * This data structure is one event of the kernel trace ring (trace.c), stamped with the TOD
+*********************************************************************************************/
+
+typedef struct trace_t {
+    cpu_t t_tod;                /* TOD of the event */
+    int t_event;                /* TRACE_EV_... */
+    memaddr t_pcb;              /* the process (its pcb address), 0 if none */
+    int t_arg[TRACE_ARGS];      /* event arguments (see TRACE_EV_...) */
+} trace_t;
+
+
+
+/*********************************************************************************************
+ * @brief Scheduling Class
+ * 
+ * This data structure is the interface between the nucleus and a scheduling policy:
+ * the policy owns the ready queue(s), the nucleus only goes through these operations
+*********************************************************************************************/
+
+typedef struct sched_class_t {
+    void    (*sc_init)();                   /* set up the empty ready queue(s) */
+    void    (*sc_enqueue)(pcb_t *p);        /* p became ready to run */
+    void    (*sc_enqueueAll)(pcb_t **tp);   /* every pcb of the queue tp became ready */
+    pcb_t **(*sc_wakeQueue)(int ioWait);    /* the ready queue a batch of woken pcbs joins as it is,
+                                               NULL if each one is placed (ioWait: all went through sc_block) */
+    pcb_t  *(*sc_dequeue)(pcb_t *p);        /* take p out of the ready queue(s), NULL if not there */
+    pcb_t  *(*sc_pickNext)();               /* remove and return the next pcb to run, NULL if none */
+    cpu_t   (*sc_timeSlice)(pcb_t *p);      /* PLT quantum to give to p */
+    void    (*sc_tick)(pcb_t *p);           /* p used its whole quantum, it is ready again */
+    void    (*sc_yield)(pcb_t *p);          /* p gave the CPU up before its quantum ended, it is ready again */
+    void    (*sc_block)(pcb_t *p);          /* p is about to block for I/O or for the pseudo-clock */
+    void    (*sc_clockTick)();              /* the pseudo-clock ticked */
+    int     (*sc_preempts)(pcb_t *p, pcb_t *curr); /* p (ready) should run before curr (running) */
+} sched_class_t, *sched_class_PTR;
+
+
+
 /*********************************************************************************************
  * @brief Semaphore Descriptor
  * 
@@ -163,13 +282,28 @@ typedef struct pcb_t {
 *********************************************************************************************/
 
 typedef struct semd_t {
-    struct semd_t *s_next; /* next element on the ASL */
+    struct semd_t *s_next, /* next element in the same ASL bucket */
+                  *s_prev; /* previous element in the same ASL bucket */
     int *s_semAdd; /* pointer to the semaphore*/
     pcb_t *s_procQ; /* tail pointer to a process queue */
 } semd_t, *semd_PTR;
 
 
 
+/*********************************************************************************************
+ * @brief Slab Descriptor
+ * 
+ * This data structure sits at the start of a RAM frame that extends a pool of 
+ * kernel objects (pcbs or semaphore descriptors); the objects follow it in the frame
+*********************************************************************************************/
+
+typedef struct slab_t {
+    struct slab_t *sl_next; /* next slab of the same pool */
+    int sl_used;            /* objects of this slab currently allocated */
+} slab_t, *slab_PTR;
+
+
+
 /**
  * @brief Semaphore type
  */
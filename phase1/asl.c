@@ -8,15 +8,33 @@
  * - semd_t: Represents a semaphore descriptor, containing:
  *   - s_semAdd: A pointer to the associated semaphore
  *   - s_procQ: A queue of PCBs waiting on the semaphore
- *   - s_next: A pointer to the next semaphore descriptor in the ASL
+ *   - s_next, s_prev: Pointers to the next and previous semaphore descriptors in the same hash bucket
  * 
- * - semd_h: The head of the ASL, always initialized with a dummy node (key = 0)
- * - semdFree_h: A free list of available semaphore descriptors, managed to optimize reuse
+ * - semdHash: The ASL itself, a hash table of SEMD_HASH_SIZE buckets keyed on s_semAdd.
+ *   Each bucket is a short chain sorted by s_semAdd, so a lookup only walks the few
+ *   descriptors that share a bucket instead of every active semaphore
+ * - semdFree_h: A free list of available semaphore descriptors, managed to optimize reuse.
+ *   It starts with the static semdTable and grows by slabs (RAM frames) when the table runs out;
+ *   a slab whose descriptors are all free is given back when the system is idle
+ * 
+ * A blocked PCB remembers its descriptor (p_semd) and its queue (p_queue), 
+ * so outBlocked unlinks it, and if needed its descriptor, without any search.
+ * 
+ * - timeout_h: The PCBs blocked with a deadline (insertBlockedTimed), a doubly linked list
+ *   (p_tmNext, p_tmPrev) sorted by p_deadline. Whichever way a PCB leaves its semaphore
+ *   (removeBlocked, outBlocked, removeAllBlocked) it also leaves this list, so the earliest
+ *   deadline is always the head (headTimeout).
+ * 
+ * A PCB waiting on any of a set of semaphores (insertBlockedAny) is registered on each of them
+ * through a proxy PCB: the proxies sit on the process queues and point back to their owner (p_waitOwner),
+ * the owner chains its proxies (p_waitNext). Whoever takes a proxy off a semaphore turns it back 
+ * into its owner (ownerBlocked), and takes the other registrations off the ASL (outBlockedAny).
  * 
  ***********************************************************************************************/
 
 #include "../h/asl.h"
 #include "../h/pcb.h"
+#include "../h/frame.h"
 #include "../h/const.h"
 #include "../h/types.h"
 
@@ -26,22 +44,164 @@
 
 /**************************************************************
  * The maximum number of semaphore
- * We reserve two dummy nodes and one descriptor for each process in the system
+ * We reserve one descriptor for each process in the system
+ * (the hash buckets need no dummy nodes)
+**************************************************************/
+
+#define MAXSEMDS MAXPROC
+
+/**************************************************************
+ * The bucket of a semaphore address
+ * Semaphores are word aligned, so the two low bits carry no information
 **************************************************************/
 
-#define MAXSEMDS (MAXPROC + 2)
+#define SEMD_HASH(semAdd) ((((memaddr) (semAdd)) >> 2) & (SEMD_HASH_SIZE - 1))
 
 /**************************************************************
  * The semaphore descriptor
 **************************************************************/
 
-static semd_t *semd_h;
+static semd_t *semdHash[SEMD_HASH_SIZE];
 static semd_t *semdFree_h;
+static semd_t semdTable[MAXSEMDS];
+static slab_PTR semdSlab_h;
+
+/**************************************************************
+ * The timed waiters, earliest deadline first
+**************************************************************/
+
+static pcb_PTR timeout_h;
+
+/**************************************************************
+ * The slabs of semaphore descriptors
+**************************************************************/
+
+/* The number of descriptors that fit in a slab, after its descriptor */
+#define SEMDS_PER_SLAB ((int) ((PAGESIZE - sizeof(slab_t)) / sizeof(semd_t)))
+
+/* TRUE if s comes from a slab rather than from semdTable */
+#define IS_SLAB_SEMD(s) ((s) < &semdTable[0] || (s) >= &semdTable[MAXSEMDS])
+
+/* The slab a descriptor lives in, slabs are frame aligned */
+#define SEMD_SLAB(s) ((slab_PTR) (((memaddr) (s)) & ~(PAGESIZE - 1)))
 
 /* ---------------------------------------------------------------------- */
 /* --------------------- The Active Semaphore List -----------------------*/
 /* ---------------------------------------------------------------------- */
 
+/**************************************************************
+ * insertFreeSemd()
+ * 
+ * Adds s to the head of the (doubly linked) free list
+ * 
+ * @param s: the semaphore descriptor
+ * @return void
+**************************************************************/
+
+static void insertFreeSemd (semd_t *s) {
+    s->s_next = semdFree_h;
+    s->s_prev = NULL;
+    if (semdFree_h != NULL) {
+        semdFree_h->s_prev = s;
+    }
+    semdFree_h = s;
+}
+
+/**************************************************************
+ * outFreeSemd()
+ * 
+ * Removes s from anywhere in the free list
+ * 
+ * @param s: the semaphore descriptor
+ * @return void
+**************************************************************/
+
+static void outFreeSemd (semd_t *s) {
+    if (s->s_prev != NULL) {
+        s->s_prev->s_next = s->s_next;
+    } else {
+        semdFree_h = s->s_next;
+    }
+
+    if (s->s_next != NULL) {
+        s->s_next->s_prev = s->s_prev;
+    }
+}
+
+/**************************************************************
+ * growSemds()
+ * 
+ * Extends the free list with a new slab of descriptors carved from a RAM frame
+ * 
+ * @param void
+ * @return int: TRUE if the pool grew, FALSE if no frame is available
+**************************************************************/
+
+static int growSemds () {
+    slab_PTR slab;
+    semd_t *s;
+    int i;
+
+    slab = (slab_PTR) allocFrame();
+    if (slab == NULL) {
+        /* no frame left (or no frame pool at all) */
+        return FALSE;
+    }
+
+    slab->sl_used = 0;
+    slab->sl_next = semdSlab_h;
+    semdSlab_h = slab;
+
+    /* The descriptors follow the slab descriptor */
+    s = (semd_t *) (slab + 1);
+    for (i = 0; i < SEMDS_PER_SLAB; i++) {
+        insertFreeSemd(&s[i]);
+    }
+    return TRUE;
+}
+
+/**************************************************************
+ * shrinkSemds()
+ * 
+ * Gives back to the frame pool the slabs whose descriptors are all free,
+ * keeping one empty slab for the next burst.
+ * Meant to be called when the system is idle.
+ * 
+ * @param void
+ * @return void
+**************************************************************/
+
+void shrinkSemds () {
+    slab_PTR slab, prev, next;
+    semd_t *s;
+    int i, spare_kept = FALSE;
+
+    prev = NULL;
+    for (slab = semdSlab_h; slab != NULL; slab = next) {
+        next = slab->sl_next;
+
+        if (slab->sl_used != 0 || !spare_kept) {
+            /* in use, or the one empty slab we keep */
+            spare_kept = spare_kept || (slab->sl_used == 0);
+            prev = slab;
+            continue;
+        }
+
+        /* Take its descriptors off the free list and unlink the slab */
+        s = (semd_t *) (slab + 1);
+        for (i = 0; i < SEMDS_PER_SLAB; i++) {
+            outFreeSemd(&s[i]);
+        }
+
+        if (prev != NULL) {
+            prev->sl_next = next;
+        } else {
+            semdSlab_h = next;
+        }
+        freeFrame(slab);
+    }
+}
+
 /**************************************************************
  * freeSemd()
  * 
@@ -56,16 +216,12 @@ void freeSemd (semd_t *s) {
         return;
     }
 
-    if (semdFree_h == NULL) {
-        /* If free list is empty */
-        s->s_next = NULL;
-        semdFree_h = s;
-        return;
+    if (IS_SLAB_SEMD(s)) {
+        SEMD_SLAB(s)->sl_used--;
     }
 
     /* Add s to the head of the free list */
-    s->s_next = semdFree_h;
-    semdFree_h = s;
+    insertFreeSemd(s);
     return;
 }
 
@@ -75,6 +231,7 @@ void freeSemd (semd_t *s) {
  * allocSemd()
  * 
  * Allocates a semaphore descriptor from the free list
+ * If the list is empty, the pool first grows by one slab
  * 
  * @param void
  * @return void
@@ -83,15 +240,20 @@ void freeSemd (semd_t *s) {
 semd_PTR allocSemd () {
     semd_t *newSemd;
     
-    if (semdFree_h == NULL) {
-        /* If free list is empty */
+    if (semdFree_h == NULL && !growSemds()) {
+        /* If free list is empty and cannot grow */
         return NULL;
     }
     
     /* Remove a descriptor from the free list */
     newSemd = semdFree_h;
-    semdFree_h = semdFree_h->s_next;
+    outFreeSemd(newSemd);
     newSemd->s_next = NULL;
+    newSemd->s_prev = NULL;
+
+    if (IS_SLAB_SEMD(newSemd)) {
+        SEMD_SLAB(newSemd)->sl_used++;
+    }
     
     return newSemd;
 }
@@ -100,38 +262,28 @@ semd_PTR allocSemd () {
  * void initASL()
  *
  * Initializes the Active Semaphore List
- * Two descriptors are reserved for dummy nodes: 
- * the dummy head (=0)
- * and dummy tail (=MAXINT)
+ * Every hash bucket starts as an empty chain and 
+ * all the descriptors are placed on the semdFree list
  * 
  * @param void
  * @return void
 **************************************************************/
 
 void initASL () {
-    static semd_t semdTable[MAXSEMDS];
-    semd_t *dummyTail;
     
-    /* Initialize the free list with the remaining semaphore descriptors */
+    /* Initialize the free list with all the semaphore descriptors */
     int i;
     semdFree_h = NULL;
+    semdSlab_h = NULL;
     for (i = 0; i < MAXSEMDS; i++) {
-        freeSemd(&semdTable[i]);
+        insertFreeSemd(&semdTable[i]);
     }
 
-    /* Initialize dummy head (index 0) */
-    semd_h = allocSemd();
-    semd_h->s_semAdd = (int *) 0;  /* dummy key: 0 */
-    semd_h->s_procQ = mkEmptyProcQ();
-    
-    /* Initialize dummy tail (index 1) */
-    dummyTail = allocSemd();
-    dummyTail->s_semAdd = (int *) MAXINT;  /* dummy key: MAXINT */
-    dummyTail->s_procQ = mkEmptyProcQ();
-    
-    /* Link the dummy head to dummy tail */
-    semd_h->s_next = dummyTail;
-    dummyTail->s_next = NULL;
+    /* Every bucket of the hash table is empty, and nobody waits with a deadline */
+    for (i = 0; i < SEMD_HASH_SIZE; i++) {
+        semdHash[i] = NULL;
+    }
+    timeout_h = NULL;
     return;
 }
 
@@ -141,10 +293,11 @@ void initASL () {
 /**************************************************************
  * semd_t *getSemd(int *semAdd, semd_t **prev)
  * 
- * A private helper function that traverses the ASL (which always begins with
- * a dummy head) and returns a pointer to the first semaphore descriptor whose key
- * is not less than semAdd. It also returns (via the out-parameter *prev) the pointer
- * to the node immediately preceding the returned node.
+ * A private helper function that hashes semAdd to its bucket, traverses the
+ * (sorted) chain of that bucket and returns a pointer to the first semaphore 
+ * descriptor whose key is not less than semAdd, or NULL if there is none. 
+ * It also returns (via the out-parameter *prev) the pointer to the node immediately 
+ * preceding the returned node, which is NULL when the returned node is the bucket head.
  * 
  * Since s_semAdd is a pointer, we cast it to unsigned long for comparison.
  * 
@@ -154,7 +307,7 @@ void initASL () {
  **************************************************************/
 
 static semd_t *getSemd (int *semAdd, semd_PTR *prev) {
-    semd_t *curr = semd_h;  /* start at dummy head */
+    semd_t *curr = semdHash[SEMD_HASH(semAdd)];  /* start at the bucket head */
     semd_t *parent = NULL;
     
     while (curr != NULL && ((unsigned long)curr->s_semAdd < (unsigned long) semAdd)) {
@@ -170,6 +323,91 @@ static semd_t *getSemd (int *semAdd, semd_PTR *prev) {
     return curr;
 }
 
+/**************************************************************
+ * unlinkSemd(semd_t *s)
+ * 
+ * A private helper function that removes the descriptor s from its
+ * hash bucket and returns it to the semdFree list.
+ * The bucket chain is doubly linked, so no search is needed.
+ * 
+ * @param s: the semaphore descriptor to remove
+ * @return void
+ **************************************************************/
+
+static void unlinkSemd (semd_t *s) {
+    if (s->s_prev != NULL) {
+        s->s_prev->s_next = s->s_next;
+    } else {
+        semdHash[SEMD_HASH(s->s_semAdd)] = s->s_next;
+    }
+
+    if (s->s_next != NULL) {
+        s->s_next->s_prev = s->s_prev;
+    }
+    freeSemd(s); /* Return the descriptor to the free list */
+}
+
+
+/**************************************************************
+ * insertTimeout(pcb_t *p, cpu_t deadline)
+ * 
+ * A private helper function that inserts p in the timeout list,
+ * after the waiters whose deadline is not later than deadline.
+ * Deadlines are TOD values, compared through their difference so they may wrap.
+ * 
+ * @param p: the process control block
+ * @param deadline: the TOD at which the wait gives up
+ * @return void
+ **************************************************************/
+
+static void insertTimeout (pcb_PTR p, cpu_t deadline) {
+    pcb_PTR prev = NULL, curr = timeout_h;
+
+    while (curr != NULL && curr->p_deadline - deadline <= 0) {
+        prev = curr;
+        curr = curr->p_tmNext;
+    }
+
+    p->p_deadline = deadline;
+    p->p_tmNext = curr;
+    p->p_tmPrev = prev;
+    if (curr != NULL) {
+        curr->p_tmPrev = p;
+    }
+    if (prev != NULL) {
+        prev->p_tmNext = p;
+    } else {
+        timeout_h = p;
+    }
+}
+
+/**************************************************************
+ * outTimeout(pcb_t *p)
+ * 
+ * A private helper function that removes p from the timeout list,
+ * if it is in it (it is the head, or has a previous waiter).
+ * 
+ * @param p: the process control block
+ * @return void
+ **************************************************************/
+
+static void outTimeout (pcb_PTR p) {
+    if (p != timeout_h && p->p_tmPrev == NULL) {
+        return;
+    }
+
+    if (p->p_tmPrev != NULL) {
+        p->p_tmPrev->p_tmNext = p->p_tmNext;
+    } else {
+        timeout_h = p->p_tmNext;
+    }
+    if (p->p_tmNext != NULL) {
+        p->p_tmNext->p_tmPrev = p->p_tmPrev;
+    }
+    p->p_tmNext = NULL;
+    p->p_tmPrev = NULL;
+}
+
 
 /* ---------------------------------------------------------------------- */
 /* ----------------------------- METHODS -------------------------------- */
@@ -183,9 +421,10 @@ static semd_t *getSemd (int *semAdd, semd_PTR *prev) {
  *
  * If a semaphore descriptor for semAdd is not already present in the ASL, then
  * allocate a new descriptor from the semdFree list, initialize it, and
- * insert it in sorted order into the ASL.
+ * insert it in sorted order into the chain of its hash bucket.
  *
- * If a new semaphore descriptor is needed but the semdFree list is empty, return TRUE.
+ * If a new semaphore descriptor is needed but the semdFree list is empty (and
+ * no frame is left to grow it), return TRUE.
  * Otherwise, return FALSE.
  * 
  * @param semAdd: the semaphore address
@@ -205,31 +444,96 @@ int insertBlocked (int *semAdd, pcb_PTR p) {
     if (curr == NULL || ((unsigned long) curr->s_semAdd != (unsigned long) semAdd)) {
         /* If not found -> allocate a new descriptor */
 
-        if (semdFree_h == NULL) {
-            /* If semdFree list is empty, we cannot allocate a new descriptor. */
-            return TRUE;
-        }
-        
         /* Remove a descriptor from the free list */
         semd_t *newSemd = allocSemd();
+
+        if (newSemd == NULL) {
+            /* If semdFree list is empty and cannot grow, we cannot allocate a new descriptor. */
+            return TRUE;
+        }
         
         /* Initialize the new semaphore descriptor */
         newSemd->s_semAdd = semAdd;
         newSemd->s_procQ = mkEmptyProcQ();
         
-        /* Insert newSemd into the ASL between prev and curr */
+        /* Insert newSemd into the bucket between prev and curr */
         newSemd->s_next = curr;
-        prev->s_next = newSemd;
+        newSemd->s_prev = prev;
+        if (curr != NULL) {
+            curr->s_prev = newSemd;
+        }
+        if (prev != NULL) {
+            prev->s_next = newSemd;
+        } else {
+            semdHash[SEMD_HASH(semAdd)] = newSemd;
+        }
         curr = newSemd;
     }
     
     p->p_semAdd = semAdd;    /* Set the semaphore address in the PCB */
+    p->p_semd = curr;        /* and the descriptor, for outBlocked */
     insertProcQ(&(curr->s_procQ), p);     /* Insert p at the tail of the process queue with this semaphore */
 
     
     return FALSE;
 }
 
+/**************************************************************
+ * insertBlockedTimed
+ *
+ * Like insertBlocked, and also inserts p in the timeout list 
+ * with the given deadline (a TOD value)
+ * 
+ * @param semAdd: the semaphore address
+ * @param p: the process control block
+ * @param deadline: the TOD at which the wait gives up
+ * @return int: TRUE if a new descriptor is needed but the semdFree list is empty, 
+ * FALSE otherwise
+**************************************************************/
+
+int insertBlockedTimed (int *semAdd, pcb_PTR p, cpu_t deadline) {
+    if (insertBlocked(semAdd, p)) {
+        return TRUE;
+    }
+    insertTimeout(p, deadline);
+    return FALSE;
+}
+
+/**************************************************************
+ * insertBlockedAny
+ *
+ * Registers p on each of the count semaphores of semAdd, through a proxy pcb
+ * per semaphore that remembers its index in the set (p_waitIndex).
+ * p itself is on no process queue, its proxies are chained from p_waitNext.
+ * The semaphores must be distinct.
+ * 
+ * @param semAdd: the semaphore addresses
+ * @param count: how many semaphores
+ * @param p: the process control block
+ * @return int: TRUE if a proxy or a descriptor could not be allocated
+ * (p is then registered nowhere), FALSE otherwise
+**************************************************************/
+
+int insertBlockedAny (int *semAdd[], int count, pcb_PTR p) {
+    pcb_PTR proxy;
+    int i;
+
+    for (i = count - 1; i >= 0; i--) {
+        proxy = allocPcb();
+        if (proxy == NULL || insertBlocked(semAdd[i], proxy)) {
+            /* Undo the registrations done so far */
+            freePcb(proxy);
+            while (outBlockedAny(p) != NULL);
+            return TRUE;
+        }
+        proxy->p_waitOwner = p;
+        proxy->p_waitIndex = i;
+        proxy->p_waitNext = p->p_waitNext;
+        p->p_waitNext = proxy;
+    }
+    return FALSE;
+}
+
 /**************************************************************
  * removeBlocked
  *
@@ -259,50 +563,148 @@ pcb_PTR removeBlocked (int *semAdd) {
     pcb_t *removed = removeProcQ(&(curr->s_procQ));
     if (removed != NULL) {
         removed->p_semAdd = NULL;
+        removed->p_semd = NULL;
+        outTimeout(removed);
     }
     
     if (emptyProcQ(curr->s_procQ)) {
         /* If the process queue is now empty, remove the semaphore descriptor from the ASL */
-        if (prev != NULL) {
-            prev->s_next = curr->s_next;
-        }
-        freeSemd(curr); /* Return the descriptor to the free list */
+        unlinkSemd(curr);
     }
     
     return removed;
 }
 
+/**************************************************************
+ * removeAllBlocked
+ *
+ * Searches the ASL for a descriptor for semaphore semAdd and moves
+ * every PCB blocked on it, in order, to the tail of the process queue
+ * whose tail pointer is pointed to by tp. 
+ * The descriptor is then removed from the ASL and returned to the semdFree list.
+ *
+ * The ASL is searched once and the queue is walked once: each PCB has p_semAdd
+ * and p_semd cleared, leaves the timeout list, gets its p_queue set to tp and 
+ * is stamped with the interrupt that woke it (for its dispatch latency),
+ * then the whole queue is spliced in constant time with spliceProcQ.
+ * 
+ * @param semAdd: the semaphore address
+ * @param tp: the tail pointer of the destination process queue
+ * @param irqIndex: the device index of the interrupt that wakes them, NO_IRQ if none
+ * @param irqTOD: the TOD of that interrupt
+ * @return int: the number of PCBs moved, 0 if the semaphore descriptor was not found
+**************************************************************/
+
+int removeAllBlocked (int *semAdd, pcb_PTR *tp, int irqIndex, cpu_t irqTOD) {
+    semd_t *prev, *curr;
+    pcb_t *p;
+    int count = 0;
+
+    curr = getSemd(semAdd, &prev);
+    if (curr == NULL || ((unsigned long) curr->s_semAdd != (unsigned long) semAdd)) {
+        /* Check that we found a descriptor with key equal to semAdd */
+        return 0;
+    }
+
+    /* None of the PCBs is blocked anymore, all of them now live on tp */
+    p = curr->s_procQ;
+    do {
+        p->p_semAdd = NULL;
+        p->p_semd = NULL;
+        p->p_queue = tp;
+        p->p_irqIndex = irqIndex;
+        p->p_irqTOD = irqTOD;
+        outTimeout(p);
+        count++;
+        p = p->p_next;
+    } while (p != curr->s_procQ);
+
+    /* Move the whole queue at once, then drop the now empty descriptor */
+    spliceProcQ(tp, &(curr->s_procQ));
+    unlinkSemd(curr);
+
+    return count;
+}
+
+/**************************************************************
+ * removeBlockedN
+ *
+ * Searches the ASL for a descriptor for semaphore semAdd and moves
+ * the first n PCBs blocked on it (all of them if there are fewer), in order, 
+ * to the tail of the process queue whose tail pointer is pointed to by tp.
+ * If no PCB is left blocked, the descriptor is removed from the ASL 
+ * and returned to the semdFree list.
+ *
+ * The ASL is searched once and the run is moved with removeProcQN, 
+ * then its PCBs (the last ones of tp) are marked as no longer blocked.
+ * 
+ * @param semAdd: the semaphore address
+ * @param tp: the tail pointer of the destination process queue
+ * @param n: how many PCBs to move
+ * @return int: the number of PCBs moved, 0 if the semaphore descriptor was not found
+**************************************************************/
+
+int removeBlockedN (int *semAdd, pcb_PTR *tp, int n) {
+    semd_t *prev, *curr;
+    pcb_t *p;
+    int count, i;
+
+    curr = getSemd(semAdd, &prev);
+    if (curr == NULL || ((unsigned long) curr->s_semAdd != (unsigned long) semAdd)) {
+        /* Check that we found a descriptor with key equal to semAdd */
+        return 0;
+    }
+
+    /* Move the run at once, then mark its PCBs as no longer blocked */
+    count = removeProcQN(tp, &(curr->s_procQ), n);
+    p = *tp;
+    for (i = 0; i < count; i++) {
+        p->p_semAdd = NULL;
+        p->p_semd = NULL;
+        outTimeout(p);
+        p = p->p_prev;
+    }
+
+    if (emptyProcQ(curr->s_procQ)) {
+        unlinkSemd(curr);
+    }
+
+    return count;
+}
+
 /**************************************************************
  * outBlocked
  *
  * Removes the PCB from the process queue associated with p->p_semAdd
  * 
+ * @note
+ * The descriptor is read from p->p_semd, so the ASL is not searched
+ * 
  * @param p: the PCB to remove
  * @return pcb_t *: the removed PCB, or NULL if p->p_semAdd is NULL
 **************************************************************/
 
 pcb_PTR outBlocked (pcb_PTR p) {
-    semd_t *prev, *curr;
+    semd_t *curr;
     
-    if (p == NULL || p->p_semAdd == NULL)
+    if (p == NULL || p->p_semAdd == NULL || p->p_semd == NULL)
         return NULL;
     
-    /* Locate the semaphore descriptor for p->p_semAdd */
-    curr = getSemd(p->p_semAdd, &prev);
-    if (curr == NULL || ((unsigned long) curr->s_semAdd != (unsigned long) p->p_semAdd))
-        return NULL;
+    /* The semaphore descriptor p is blocked on */
+    curr = p->p_semd;
     
     /* Remove p from the process queue */
     pcb_t *removed = outProcQ(&(curr->s_procQ), p);
     if (removed == NULL) {
         return NULL;
     }
+    removed->p_semAdd = NULL;
+    removed->p_semd = NULL;
+    outTimeout(removed);
     
     if (emptyProcQ(curr->s_procQ)) {
         /* If the process queue is now empty, remove the descriptor from the ASL */
-        if (prev != NULL)
-            prev->s_next = curr->s_next;
-        freeSemd(curr); /* Return the descriptor to the free list */
+        unlinkSemd(curr);
     }
     
     return removed;
@@ -329,3 +731,70 @@ pcb_t *headBlocked (int *semAdd) {
     return headProcQ(curr->s_procQ);
 }
 
+/**************************************************************
+ * headTimeout
+ *
+ * Returns the blocked PCB with the earliest deadline (it stays blocked).
+ *
+ * @param void
+ * @return pcb_t *: the head of the timeout list, NULL if nobody waits with a deadline
+ **************************************************************/
+
+pcb_t *headTimeout () {
+    return timeout_h;
+}
+
+/**************************************************************
+ * outBlockedAny
+ *
+ * Takes one of the remaining registrations of p (see insertBlockedAny) 
+ * off the ASL and frees its proxy.
+ *
+ * @param p: the process control block
+ * @return int *: the semaphore it was registered on, NULL if none is left
+ **************************************************************/
+
+int *outBlockedAny (pcb_PTR p) {
+    pcb_PTR proxy = p->p_waitNext;
+    int *semAdd;
+
+    if (proxy == NULL) {
+        return NULL;
+    }
+
+    p->p_waitNext = proxy->p_waitNext;
+    semAdd = proxy->p_semAdd;
+    outBlocked(proxy);
+    freePcb(proxy);
+    return semAdd;
+}
+
+/**************************************************************
+ * ownerBlocked
+ *
+ * Turns a pcb just taken off a semaphore back into the process that waits:
+ * if p is a proxy, it is unchained and freed, and its owner gets the index of
+ * the semaphore that was signalled (p_waitIndex). Any other pcb is returned as is.
+ *
+ * @param p: the pcb taken off a semaphore
+ * @return pcb_t *: the waiting process
+ **************************************************************/
+
+pcb_t *ownerBlocked (pcb_PTR p) {
+    pcb_PTR owner, prev;
+
+    if (p == NULL || p->p_waitOwner == NULL) {
+        return p;
+    }
+
+    owner = p->p_waitOwner;
+    if (owner->p_waitNext == p) {
+        owner->p_waitNext = p->p_waitNext;
+    } else {
+        for (prev = owner->p_waitNext; prev->p_waitNext != p; prev = prev->p_waitNext);
+        prev->p_waitNext = p->p_waitNext;
+    }
+    owner->p_waitIndex = p->p_waitIndex;
+    freePcb(p);
+    return owner;
+}
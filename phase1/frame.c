@@ -0,0 +1,104 @@
+/***********************************************************************************************
+ * Kernel Frame Pool Implementation
+ * --------------------------------------
+ * This module hands out whole RAM page frames to the kernel, so that the pcb and
+ * semaphore descriptor pools can grow past their static tables when the system
+ * runs more processes than MAXPROC, and give the frames back when they shrink.
+ *
+ * Data Structures:
+ * - frameNext: The first frame of the pool that has never been handed out.
+ *   Frames in [frameNext, frameEnd) are carved on demand.
+ * - frameFree_h: The head of the list of frames that were handed out and given back;
+ *   a free frame keeps the address of the next free frame in its first word.
+ *
+ * Until initFrames is called the pool is empty and allocFrame always fails,
+ * so a kernel that does not set up the pool (as the phase 1 test) keeps 
+ * the fixed MAXPROC pools.
+ * 
+***********************************************************************************************/
+
+#include "../h/frame.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* ------------------------------------------------------ */
+/* ------------------ Global Variables ------------------ */
+/* ------------------------------------------------------ */
+
+static memaddr frameNext;   /* first never used frame */
+static memaddr frameEnd;    /* end of the pool (excluded) */
+static void *frameFree_h = NULL;  /* list of given back frames */
+
+/* ----------------------------------------------------------------------- */
+/* ------------------ Allocation/Deallocation Functions ------------------ */
+/* ----------------------------------------------------------------------- */
+
+/**************************************************************
+ * initFrames
+ *
+ * Initialize the frame pool to the RAM between start and end.
+ * start is rounded up and end is rounded down to a frame boundary.
+ * 
+ * @param start: the first address of the pool
+ * @param end: the end address of the pool (excluded)
+ * @return void
+**************************************************************/
+
+void initFrames (memaddr start, memaddr end) {
+    frameNext = (start + PAGESIZE - 1) & ~(PAGESIZE - 1);
+    frameEnd = end & ~(PAGESIZE - 1);
+    frameFree_h = NULL;
+
+    if (frameNext > frameEnd) {
+        /* no room for a single frame */
+        frameNext = frameEnd;
+    }
+}
+
+/**************************************************************
+ * allocFrame
+ *
+ * Allocate one page frame, reusing a given back frame first
+ * 
+ * @param void
+ * @return: the address of the frame, or NULL if the pool is exhausted
+**************************************************************/
+
+void *allocFrame () {
+    void *frame;
+
+    if (frameFree_h != NULL) {
+        /* Reuse a frame that was given back */
+        frame = frameFree_h;
+        frameFree_h = *((void **) frame);
+        return frame;
+    }
+
+    if (frameNext >= frameEnd) {
+        /* The pool is exhausted (or was never initialized) */
+        return NULL;
+    }
+
+    /* Carve a new frame */
+    frame = (void *) frameNext;
+    frameNext += PAGESIZE;
+    return frame;
+}
+
+/**************************************************************
+ * freeFrame
+ *
+ * Give a frame obtained from allocFrame back to the pool
+ * 
+ * @param frame: the frame to give back
+ * @return: void
+**************************************************************/
+
+void freeFrame (void *frame) {
+    if (frame == NULL) {
+        return;
+    }
+
+    *((void **) frame) = frameFree_h;
+    frameFree_h = frame;
+}
@@ -10,14 +10,22 @@
  *   - p_prnt, p_child, p_lSib, p_rSib: Pointers for managing the process tree structure
  *   - p_s: The process state
  *   - p_time: The CPU time used by the process
+ *   - p_level, p_priority, p_background, p_vruntime, p_h*: The scheduling state read by the scheduling
+ *     policies (MLFQ level, static priority, background flag, CFS virtual runtime and heap links)
  *   - p_semAdd: Pointer to the semaphore the process is blocked on
+ *   - p_queue: The tail pointer of the process queue the pcb currently lives on,
+ *     so a pcb can be taken out of its queue without searching for it
  *
  * - pcbFree_h: The head of the free list containing unused PCBs
+ * - pcbFreeTable: The static array of MAXPROC PCBs the pool starts with
+ * - pcbSlab_h: The RAM frames (slabs) the pool grew into when pcbFreeTable ran out.
+ *   A slab whose PCBs are all free is given back to the frame pool when the system is idle
  * - Process Queue: A circular doubly linked list structure used for managing ready and blocked processes
  * 
 ***********************************************************************************************/
 
 #include "../h/pcb.h"
+#include "../h/frame.h"
 #include "../h/const.h"
 #include "../h/types.h"
 
@@ -26,6 +34,135 @@
 /* ------------------------------------------------------ */
 
 static pcb_PTR pcbFree_h;
+static pcb_t pcbFreeTable[MAXPROC];
+static slab_PTR pcbSlab_h;
+
+/* The number of pcbs that fit in a slab, after its descriptor */
+#define PCBS_PER_SLAB ((int) ((PAGESIZE - sizeof(slab_t)) / sizeof(pcb_t)))
+
+/* TRUE if p comes from a slab rather than from pcbFreeTable */
+#define IS_SLAB_PCB(p) ((p) < &pcbFreeTable[0] || (p) >= &pcbFreeTable[MAXPROC])
+
+/* The slab a pcb lives in, slabs are frame aligned */
+#define PCB_SLAB(p) ((slab_PTR) (((memaddr) (p)) & ~(PAGESIZE - 1)))
+
+/* ------------------------------------------------------------ */
+/* ------------------ Free List Maintainance ------------------ */
+/* ------------------------------------------------------------ */
+
+/**************************************************************
+ * insertFreePcb
+ *
+ * Insert p at the head of the (doubly linked) free list
+ * 
+ * @param p: the pcb to insert
+ * @return: void
+**************************************************************/
+
+static void insertFreePcb (pcb_PTR p) {
+    p->p_next = pcbFree_h;
+    p->p_prev = NULL;
+    if (pcbFree_h != NULL) {
+        pcbFree_h->p_prev = p;
+    }
+    pcbFree_h = p;
+}
+
+/**************************************************************
+ * outFreePcb
+ *
+ * Remove p from anywhere in the free list
+ * 
+ * @param p: the pcb to remove
+ * @return: void
+**************************************************************/
+
+static void outFreePcb (pcb_PTR p) {
+    if (p->p_prev != NULL) {
+        p->p_prev->p_next = p->p_next;
+    } else {
+        pcbFree_h = p->p_next;
+    }
+
+    if (p->p_next != NULL) {
+        p->p_next->p_prev = p->p_prev;
+    }
+}
+
+/**************************************************************
+ * growPcbs
+ *
+ * Extend the pool with a new slab of pcbs carved from a RAM frame
+ * 
+ * @param void
+ * @return: TRUE if the pool grew, FALSE if no frame is available
+**************************************************************/
+
+static int growPcbs () {
+    slab_PTR slab;
+    pcb_PTR p;
+    int i;
+
+    slab = (slab_PTR) allocFrame();
+    if (slab == NULL) {
+        /* no frame left (or no frame pool at all) */
+        return FALSE;
+    }
+
+    slab->sl_used = 0;
+    slab->sl_next = pcbSlab_h;
+    pcbSlab_h = slab;
+
+    /* The pcbs follow the slab descriptor */
+    p = (pcb_PTR) (slab + 1);
+    for (i = 0; i < PCBS_PER_SLAB; i++) {
+        insertFreePcb(&p[i]);
+    }
+    return TRUE;
+}
+
+/**************************************************************
+ * shrinkPcbs
+ *
+ * Give back to the frame pool the slabs whose pcbs are all free.
+ * One empty slab is kept, so that a burst of process creation 
+ * right after does not have to grow the pool again.
+ * Meant to be called when the system is idle.
+ * 
+ * @param void
+ * @return void
+**************************************************************/
+
+void shrinkPcbs () {
+    slab_PTR slab, prev, next;
+    pcb_PTR p;
+    int i, spare_kept = FALSE;
+
+    prev = NULL;
+    for (slab = pcbSlab_h; slab != NULL; slab = next) {
+        next = slab->sl_next;
+
+        if (slab->sl_used != 0 || !spare_kept) {
+            /* in use, or the one empty slab we keep */
+            spare_kept = spare_kept || (slab->sl_used == 0);
+            prev = slab;
+            continue;
+        }
+
+        /* Take its pcbs off the free list and unlink the slab */
+        p = (pcb_PTR) (slab + 1);
+        for (i = 0; i < PCBS_PER_SLAB; i++) {
+            outFreePcb(&p[i]);
+        }
+
+        if (prev != NULL) {
+            prev->sl_next = next;
+        } else {
+            pcbSlab_h = next;
+        }
+        freeFrame(slab);
+    }
+}
 
 /* ----------------------------------------------------------------------- */
 /* ------------------ Allocation/Deallocation Functions ------------------ */
@@ -36,20 +173,21 @@ static pcb_PTR pcbFree_h;
  *
  * Initialize the pcbFree list to contain all the 
  * elements of the static array of MAXPROC pcbs
+ * The pool has no slab yet
  * 
  * @param void
  * @return void
 **************************************************************/
 
 void initPcbs () {
-    static pcb_t pcbFreeTable[MAXPROC];
     pcbFree_h = NULL;  /* The free list is empty at first */
+    pcbSlab_h = NULL;
     
     int i; /* Loop counter */
     for (i = 0; i < MAXPROC; i++) {
         /* For each pcb in the static array, insert it into the free list */
 
-        freePcb(&pcbFreeTable[i]); /* add pcb to the free list */
+        insertFreePcb(&pcbFreeTable[i]); /* add pcb to the free list */
     }
 }
 
@@ -57,6 +195,7 @@ void initPcbs () {
  * allocPcb
  *
  * Allocate a pcb from the pcbFree list
+ * If the list is empty, the pool first grows by one slab
  * 
  * @param void
  * @return: a pointer to the allocated pcb, or NULL if no pcbs are available
@@ -65,14 +204,18 @@ void initPcbs () {
 pcb_PTR allocPcb () {
     pcb_t *p;
 
-    if (pcbFree_h == NULL) {
-        /* The free list is empty */
+    if (pcbFree_h == NULL && !growPcbs()) {
+        /* The free list is empty and cannot grow */
         return NULL;  
     }
 
     /* Remove one pcb from the free list */
     p = pcbFree_h;
-    pcbFree_h = pcbFree_h->p_next;
+    outFreePcb(p);
+
+    if (IS_SLAB_PCB(p)) {
+        PCB_SLAB(p)->sl_used++;
+    }
 
     /* Initialize all fields of the pcb to default values */
     p->p_next    = NULL;
@@ -91,7 +234,26 @@ pcb_PTR allocPcb () {
 
     /* Initialize other pcb fields */
     p->p_time   = 0;
+    p->p_level  = MLFQ_TOP_LEVEL;
+    p->p_priority = PRIO_DEFAULT;
+    p->p_background = FALSE;
+    p->p_vruntime = 0;
+    p->p_vcharged = 0;
+    p->p_hChild = NULL;
+    p->p_hSib   = NULL;
+    p->p_hPrev  = NULL;
     p->p_semAdd = NULL;
+    p->p_semd   = NULL;
+    p->p_deadline = 0;
+    p->p_tmNext = NULL;
+    p->p_tmPrev = NULL;
+    p->p_waitOwner = NULL;
+    p->p_waitNext = NULL;
+    p->p_waitIndex = 0;
+    p->p_irqIndex = NO_IRQ;
+    p->p_irqTOD = 0;
+    p->p_traceSys = 0;
+    p->p_queue  = NULL;
 
     p->p_supportStruct = NULL;
 
@@ -114,24 +276,61 @@ void freePcb (pcb_PTR p) {
         return;  
     }
 
-
-    if (pcbFree_h == NULL) {
-        /* The free list is empty */
-        p->p_next = NULL;
-        p->p_prev = NULL;
-        pcbFree_h = p;
-        return;
-    } 
+    if (IS_SLAB_PCB(p)) {
+        PCB_SLAB(p)->sl_used--;
+    }
 
     /* Insert p at the head of the free list */
-    p->p_next = pcbFree_h;
-    p->p_prev = NULL;
-    pcbFree_h->p_prev = p;
-    pcbFree_h = p;
+    insertFreePcb(p);
     return;
 }
 
 
+/**************************************************************
+ * freeProcQ
+ *
+ * Return every pcb of the process queue whose tail pointer
+ * is pointed to by tp to the free list at once.
+ * The circular queue is opened and spliced in front of the free list
+ * in constant time (after a pass that updates the slab counters), 
+ * and the queue is left empty.
+ * 
+ * @param tp: the tail pointer of the process queue
+ * @return: void
+**************************************************************/
+
+void freeProcQ (pcb_PTR *tp) {
+    pcb_t *head, *tail, *p;
+
+    if (tp == NULL || *tp == NULL) {
+        /* nothing to free */
+        return;
+    }
+
+    tail = *tp;
+    head = tail->p_next;
+
+    /* Every slab loses its pcbs that are on the queue */
+    p = head;
+    do {
+        if (IS_SLAB_PCB(p)) {
+            PCB_SLAB(p)->sl_used--;
+        }
+        p = p->p_next;
+    } while (p != head);
+
+    /* Open the circle: head starts the free list, tail leads to the old free list */
+    head->p_prev = NULL;
+    tail->p_next = pcbFree_h;
+    if (pcbFree_h != NULL) {
+        pcbFree_h->p_prev = tail;
+    }
+    pcbFree_h = head;
+
+    *tp = NULL;
+}
+
+
 /* ---------------------------------------------------------------- */
 /* ------------------ Process Queue Maintainance ------------------ */
 /* ---------------------------------------------------------------- */
@@ -193,6 +392,8 @@ void insertProcQ (pcb_PTR *tp, pcb_PTR p) {
         
         *tp = p; /* p becomes the new tail */
     }
+
+    p->p_queue = tp; /* remember which queue p lives on */
 }
 /**************************************************************
  * removeProcQ
@@ -227,6 +428,7 @@ pcb_PTR removeProcQ (pcb_PTR *tp) {
     /* Clear the removed pointer */
     head->p_next = NULL;
     head->p_prev = NULL;
+    head->p_queue = NULL;
     return head;
 }
 
@@ -234,49 +436,169 @@ pcb_PTR removeProcQ (pcb_PTR *tp) {
  * outProcQ
  *
  * Remove the pcb pointed to by p from the process queue
- * If p is not found, return NULL, otherwise, return p
+ * If p is not in the queue, return NULL, otherwise, return p
  * Update the tail pointer if necessary
  * 
+ * @note
+ * p->p_queue tells which queue p lives on, so there is no need to 
+ * search the queue: p is unlinked directly in constant time
+ * 
  * @param tp: the tail pointer of the process queue
  * @param p: the pcb to remove
  * @return: the removed pcb, or NULL if p is not in the queue
 **************************************************************/
 
 pcb_PTR outProcQ (pcb_PTR *tp, pcb_PTR p) {
-    pcb_t *current, *tail;
 
-    if (tp == NULL || *tp == NULL || p == NULL) {
+    if (tp == NULL || *tp == NULL || p == NULL || p->p_queue != tp) {
+        /* p does not live on this queue */
         return NULL;
     }
     
-    tail = *tp;
-    current = tail->p_next; /* start at the head */
+    if (p->p_next == p) { 
+        /* p is the only element in the queue */
+        *tp = NULL;
+    } else {
+        /* Remove p from the list */
+        p->p_prev->p_next = p->p_next;
+        p->p_next->p_prev = p->p_prev;
+        if (p == *tp) {  /* if p is the tail, update tail pointer */
+            *tp = p->p_prev;
+        }
+    }
+
+    /* Clear removed pcb pointers */
+    p->p_next = NULL;
+    p->p_prev = NULL;
+    p->p_queue = NULL;
+    return p;
+}
+
+/**************************************************************
+ * spliceProcQ
+ *
+ * Append the queue tq at the end of the queue tp in constant time,
+ * by relinking the two heads and the two tails.
+ * The p_queue of the appended pcbs must already be tp: callers that 
+ * walk tq anyway (e.g. removeAllBlocked) set it on the way, instead of 
+ * paying for the walk of concatProcQ.
+ * The queue tq is left empty.
+ * 
+ * @param tp: the tail pointer of the destination queue
+ * @param tq: the tail pointer of the queue to append
+ * @return: void
+**************************************************************/
+
+void spliceProcQ (pcb_PTR *tp, pcb_PTR *tq) {
+    pcb_t *headP, *headQ;
+
+    if (*tp == NULL) {
+        /* The destination is empty, it simply takes over tq */
+        *tp = *tq;
+        *tq = NULL;
+        return;
+    }
 
-    /* Loop over the circular queue until return to the head */
+    headP = (*tp)->p_next;
+    headQ = (*tq)->p_next;
+
+    /* The tail of tp now leads to the head of tq ... */
+    (*tp)->p_next = headQ;
+    headQ->p_prev = *tp;
+
+    /* ... and the tail of tq closes the circle back to the head of tp */
+    (*tq)->p_next = headP;
+    headP->p_prev = *tq;
+
+    *tp = *tq; /* the tail of tq becomes the new tail */
+    *tq = NULL;
+}
+
+/**************************************************************
+ * concatProcQ
+ *
+ * Append every pcb of the process queue whose tail pointer is 
+ * pointed to by tq at the end of the process queue whose tail 
+ * pointer is pointed to by tp, keeping their order.
+ * The queue tq is left empty.
+ * The appended pcbs first have their p_queue retargeted to tp, one by one,
+ * so the cost is linear in the length of tq; only the splice itself 
+ * (spliceProcQ) is done in constant time.
+ * 
+ * @param tp: the tail pointer of the destination queue
+ * @param tq: the tail pointer of the queue to append
+ * @return: void
+**************************************************************/
+
+void concatProcQ (pcb_PTR *tp, pcb_PTR *tq) {
+    pcb_t *curr;
+
+    if (tp == NULL || tq == NULL || *tq == NULL) {
+        /* nothing to append */
+        return;
+    }
+
+    /* Every pcb of tq now lives on tp */
+    curr = *tq;
     do {
-        if (current == p) { 
-            /* Found the element to remove */
-            
-            if (current->p_next == current) { 
-                /* p is the only element in the queue */
-                *tp = NULL;
-            } else {
-                /* Remove current from the list */
-                current->p_prev->p_next = current->p_next;
-                current->p_next->p_prev = current->p_prev;
-                if (current == *tp) {  /* if p is the tail, update tail pointer */
-                    *tp = current->p_prev;
-                }
-            }
-            /* Clear removed pcb pointers */
-            p->p_next = NULL;
-            p->p_prev = NULL;
-            return p;
+        curr->p_queue = tp;
+        curr = curr->p_next;
+    } while (curr != *tq);
+
+    spliceProcQ(tp, tq);
+}
+
+/**************************************************************
+ * removeProcQN
+ *
+ * Move the first n pcbs of the process queue whose tail pointer is
+ * pointed to by tq (all of them if it holds fewer) to the end of the 
+ * process queue whose tail pointer is pointed to by tp, keeping their order.
+ * The moved run is walked once (to retarget p_queue) and then cut out
+ * and spliced in constant time.
+ * 
+ * @param tp: the tail pointer of the destination queue
+ * @param tq: the tail pointer of the source queue
+ * @param n: how many pcbs to move
+ * @return: the number of pcbs moved
+**************************************************************/
+
+int removeProcQN (pcb_PTR *tp, pcb_PTR *tq, int n) {
+    pcb_t *head, *last, *run;
+    int count = 0;
+
+    if (tp == NULL || tq == NULL || *tq == NULL || n <= 0) {
+        /* nothing to move */
+        return 0;
+    }
+
+    /* Walk the first n pcbs, they now live on tp */
+    head = (*tq)->p_next;
+    last = head;
+    while (TRUE) {
+        last->p_queue = tp;
+        count++;
+        if (count == n || last == *tq) {
+            break;
         }
-        current = current->p_next;
-    } while (current != tail->p_next);
+        last = last->p_next;
+    }
 
-    return NULL; /* p was not found in the queue */
+    if (last == *tq) {
+        /* The whole queue moves */
+        run = *tq;
+        *tq = NULL;
+    } else {
+        /* Cut head..last out of tq and close it into a circle of its own */
+        (*tq)->p_next = last->p_next;
+        last->p_next->p_prev = *tq;
+        last->p_next = head;
+        head->p_prev = last;
+        run = last;
+    }
+
+    spliceProcQ(tp, &run);
+    return count;
 }
 
 /**************************************************************
@@ -370,6 +692,10 @@ pcb_PTR removeChild (pcb_PTR p) {
     /* Remove the first child */
     child = p->p_child;
     p->p_child = child->p_rSib;
+    if (p->p_child != NULL) {
+        /* the next sibling is now the first child */
+        p->p_child->p_lSib = NULL;
+    }
 
     /* Remove the reference from the removed child */
     child->p_prnt = NULL;
@@ -385,12 +711,16 @@ pcb_PTR removeChild (pcb_PTR p) {
  * Remove the pcb from the child list of its parent
  * If p has no parent, return NULL; otherwise, return p
  * 
+ * @note
+ * The child list is doubly linked through p_lSib and p_rSib, 
+ * so p is unlinked directly without searching its siblings
+ * 
  * @param p: the pcb to remove
  * @return: the removed pcb, or NULL if p has no parent
 **************************************************************/
 
 pcb_PTR outChild (pcb_PTR p) {
-    pcb_t *prnt, *cur;
+    pcb_t *prnt;
     
     if (p == NULL || p->p_prnt == NULL) {
         return NULL;
@@ -401,26 +731,17 @@ pcb_PTR outChild (pcb_PTR p) {
     /* If p is the first child, update prnt->p_child directly */
     if (prnt->p_child == p) {
         removeChild(prnt);
-    } else {
-        /* Otherwise, search the child list for p */
-        cur = prnt->p_child;
-        while (cur != NULL && cur->p_rSib != p) {
-            cur = cur->p_rSib;
-        }
+        return p;
+    }
 
-        if (cur != NULL) {
-            cur->p_rSib = p->p_rSib;
-            if (p->p_rSib != NULL) {
-                ((pcb_PTR)p->p_rSib)->p_lSib = cur;
-            }
-        } else {
-            /* p not found in parent's child list */
-            return NULL;
-        }
+    /* Otherwise, bridge the left sibling to the right sibling */
+    p->p_lSib->p_rSib = p->p_rSib;
+    if (p->p_rSib != NULL) {
+        p->p_rSib->p_lSib = p->p_lSib;
     }
     
     p->p_prnt = NULL;
     p->p_rSib = NULL;
     p->p_lSib = NULL;
     return p;
-}
\ No newline at end of file
+}
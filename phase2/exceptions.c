@@ -17,6 +17,14 @@
  * This file is also responsible for managing the system calls and their associated behaviors.
  * It manages 8 distinct system calls, including createProcess, terminateProcess, passeren, verhogen,
  * waitForIO, getCPUTime, waitForClock, and getSupportData.
+ * The nucleus extensions use negative numbers, so they never collide with the Support Level
+ * SYSCALLs (9 and up) that are passed up: SETSCHED (-1) selects the scheduling policy,
+ * SETPRIO (-2) sets the static priority of the caller, SIGNALWAIT (-3) performs a V and a P
+ * in one trap, MULTICALL (-4) runs a batch of P, V and get CPU time operations in one trap,
+ * TRYP (-5) performs a P only if it does not block, TIMEDP (-6) performs a P that gives up at a deadline,
+ * WAITANY (-7) waits on the first of a set of semaphores, VN (-8) performs n V at once,
+ * BROADCAST (-9) releases every process waiting on a semaphore, IRQSTATS (-10) reads the 
+ * interrupt latency statistics, TRACECTL (-11) sets which events the kernel trace records.
  * 
  * 3. Different Types of Exceptions
  *      - interruptTrapHandler: function is the handler for Interrupt exceptions. 
@@ -40,6 +48,7 @@
  * These include
  *     - addPigeonCurrentProcessHelper: add the exception state to the current process
  *      - blockCurrentProcessHelper: block the current process
+ *      - claimWaiterHelper, claimAllWaitersHelper, cancelWaitAnyHelper: wake or cancel a WAITANY
  *
  * 6. TIME POLICIES
  * 
@@ -108,8 +117,10 @@
 
 #include "../h/initial.h"
 #include "../h/scheduler.h"
+#include "../h/policy.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/trace.h"
 #include "../h/types.h"
 #include "../h/const.h"
 #include "../h/asl.h"
@@ -185,11 +196,118 @@ void blockCurrentProcessHelper(int *this_semaphore){
 
     /* STEP 2: insert the current process into the blocked list */
     insertBlocked(this_semaphore, currentProcess);
+    TRACE(TRACE_BLOCK, TRACE_EV_BLOCK, currentProcess, this_semaphore, 0, 0, 0);
 
     /* STEP 3: set the current process to NULL */
     currentProcess = NULL;
 }
 
+/*********************************************************************************************
+ * cancelWaitAnyHelper
+ * 
+ * @brief
+ * This function takes a process waiting on a set of semaphores (WAITANY) off the semaphores
+ * it is still registered on, undoing the P of each one.
+ * 
+ * @protocol
+ * 1. For every remaining registration (outBlockedAny)
+ *      - If it is a non-device semaphore, increment the semaphore value
+ *      - If it is a device semaphore, decrease the soft block count, and increment the semaphore
+ *        value only if the process lives on (see below)
+ * 
+ * @note
+ * A terminated process follows the rule of terminateProcess: the I/O it started still completes 
+ * and its V balances the P. A woken WAITANY waits again: its P on the other device semaphores is
+ * given back, so a completion that arrives meanwhile leaves the semaphore at 1 with its status kept
+ * (devicePendingStatus), and the next WAITANY (or SYS5) returns right away with it.
+ * 
+ * @param owner: the waiting process
+ * @param alive: TRUE if the process is woken, FALSE if it is terminated
+ * @return void
+*********************************************************************************************/
+void cancelWaitAnyHelper(pcb_PTR owner, int alive) {
+    int *this_semaphore;
+
+    while ((this_semaphore = outBlockedAny(owner)) != NULL) {
+        if ( ! (
+                (this_semaphore >= &semaphoreDevices[0]) && 
+                (this_semaphore <= &semaphoreDevices[CLOCK_INDEX])
+            )) {
+            ( *(this_semaphore) )++;
+        } else {
+            softBlockedCount--;
+            if (alive) {
+                ( *(this_semaphore) )++;
+            }
+        }
+    }
+}
+
+/*********************************************************************************************
+ * claimWaiterHelper
+ * 
+ * @brief
+ * This function is used on every pcb taken off a semaphore that is about to be woken.
+ * If it is the proxy of a process waiting on a set of semaphores (WAITANY), 
+ * the process itself is woken instead.
+ * 
+ * @protocol
+ * 1. If the pcb is not a proxy, return it
+ * 2. Turn the proxy into its owner (ownerBlocked), and place the index of the signalled semaphore in v0
+ * 3. Take the owner off the other semaphores of the set (cancelWaitAnyHelper)
+ * 
+ * @param this_pcb: the pcb taken off a semaphore (may be NULL)
+ * @return pcb_PTR: the process to wake
+*********************************************************************************************/
+pcb_PTR claimWaiterHelper(pcb_PTR this_pcb) {
+    if (this_pcb == NULL || this_pcb->p_waitOwner == NULL) {
+        return this_pcb;
+    }
+
+    this_pcb = ownerBlocked(this_pcb);
+    this_pcb->p_s.s_v0 = this_pcb->p_waitIndex;
+    cancelWaitAnyHelper(this_pcb, TRUE);
+    return this_pcb;
+}
+
+/*********************************************************************************************
+ * claimAllWaitersHelper
+ * 
+ * @brief
+ * claimWaiterHelper for a whole queue of pcbs taken off a semaphore at once (removeAllBlocked),
+ * or for the run of them appended to a queue: every proxy is replaced by its owner, which takes 
+ * over its interrupt stamp and goes to the tail of the queue.
+ * 
+ * @note
+ * A set never names a semaphore twice, so a queue holds at most one proxy per owner.
+ * 
+ * @param tp: the tail pointer of the queue
+ * @param after: the pcb the run starts after, NULL if it starts at the head
+ * @param count: how many pcbs the run holds
+ * @return void
+*********************************************************************************************/
+void claimAllWaitersHelper(pcb_PTR *tp, pcb_PTR after, int count) {
+    pcb_PTR this_pcb = (after == NULL) ? headProcQ(*tp) : after->p_next;
+    pcb_PTR next_pcb, owner_pcb;
+    int irq_index;
+    cpu_t irq_TOD;
+
+    while (count > 0) {
+        next_pcb = this_pcb->p_next;
+        if (this_pcb->p_waitOwner != NULL) {
+            irq_index = this_pcb->p_irqIndex;
+            irq_TOD = this_pcb->p_irqTOD;
+            outProcQ(tp, this_pcb);
+            owner_pcb = claimWaiterHelper(this_pcb);
+            owner_pcb->p_irqIndex = irq_index;
+            owner_pcb->p_irqTOD = irq_TOD;
+            insertProcQ(tp, owner_pcb);
+        }
+        this_pcb = next_pcb;
+        count--;
+    }
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 /* -------------------------------------- EXCEPTION HANDLER ------------------------------------- */
 /* ---------------------------------------------------------------------------------------------- */
@@ -270,22 +388,28 @@ void exceptionHandler() {
  *      - p_supportStruct from a2,                                      (S3)
  *      - sets the new process' time to 0,                              (S4)
  *      - sets the new process' semaphore address to NULL,              (S5)
+ *        and its static priority from a3: PRIO_INHERIT (0) gives it the priority
+ *        of the current process, otherwise a3 is the priority + 1
  *      - inserts the new process as a child of the current process     (S6)
  *      - inserts the new process into the Ready Queue                  (S7)
  *      - increments the process count.                                 (S8)
- * 2. If the allocation of the new PCB was not successful,
+ * 2. If the allocation of the new PCB was not successful (or a3 is not a priority),
  *     - Place the value -1 in the caller’s v0.                         (S9)
  * 3. Return control to the current process.                            (S10)
  * 
  * 
  * @param state_process: the state of the system
  * @param support_process: the support struct
+ * @param priority_arg: PRIO_INHERIT, or the priority of the new process + 1
  * @return void
 *********************************************************************************************/
-HIDDEN void createProcess(state_PTR state_process, support_PTR support_process) {
+HIDDEN void createProcess(state_PTR state_process, support_PTR support_process, int priority_arg) {
 
-    /* S1: It allocates a new PCB */
-    pcb_PTR new_pcb = allocPcb();
+    /* S1: It allocates a new PCB (unless a3 asks for an unknown priority) */
+    pcb_PTR new_pcb = NULL;
+    if (priority_arg >= PRIO_INHERIT && priority_arg <= PRIO_LEVELS) {
+        new_pcb = allocPcb();
+    }
     
     /* S1: If the allocation of the new PCB was successful */
     if (new_pcb != NULL){ 
@@ -299,13 +423,18 @@ HIDDEN void createProcess(state_PTR state_process, support_PTR support_process)
         /* S4: The new process has init time (0) and no semaphore (not ready to run yet)*/
         new_pcb->p_time = PROCESS_INIT_START;
 
-        /* S5: sets the new process' semaphore address to NULL */
+        /* S5: sets the new process' semaphore address to NULL, and its priority from a3 */
         new_pcb->p_semAdd = NULL;
+        if (priority_arg == PRIO_INHERIT) {
+            new_pcb->p_priority = currentProcess->p_priority;
+        } else {
+            new_pcb->p_priority = priority_arg - 1;
+        }
 
         /* S6 + S7 Make this new pcb as the child of the 
         current process and add PVB to ready queue */
         insertChild(currentProcess, new_pcb);
-        insertProcQ(&readyQueue, new_pcb);
+        insertReadyQueueHelper(new_pcb);
 
         /* Place the value 0 in the caller’s v0. */
         currentProcess->p_s.s_v0 = SUCCESS_CONST;
@@ -334,17 +463,25 @@ HIDDEN void createProcess(state_PTR state_process, support_PTR support_process)
  * This ensures that no part of the process’s “family tree” is left running.
  * 
  * @protocol
- * 1. Recursively terminate all children of the process to be terminated.
- * 2. Check the position of the process:
+ * 1. Detach the process to be terminated from its parent.
+ * 2. Walk its subtree in post-order, without recursion:
+ *      - descend through p_child until reaching a process with no children,
+ *      - remove that process from its parent (it is always the first child, so this is O(1)),
+ *      - climb back to the parent, which may now have no children left.
+ * 3. For every process reached, check the position of the process:
  *      - Then determine if the process is blocked on the ASL,
  *          - OutBlocked the process
- *          - If it is in device semaphores, increment the semaphore value
- *          - if it is in non-device semaphores, decrease the soft block count
+ *          - If it is in non-device semaphores, increment the semaphore value
+ *          - if it is in device semaphores, count it to decrease the soft block count
+ *      - Waiting on a set of semaphores (WAITANY)
+ *          - take it off all of them (cancelWaitAnyHelper)
  *      - In the Ready Queue
  *          - remove it from the Ready Queue to free it later
  *      - Current Process
- *          - then simply detach it from the parent to ready to free later
- * 3. After all the processes have been terminated, the operating system calls the Scheduler, 
+ *          - it was already detached in step 1
+ *    then put it on a local queue of dead processes.
+ * 4. Free all the dead PCBs at once and update processCount and softBlockedCount in aggregate.
+ * 5. After all the processes have been terminated, the operating system calls the Scheduler, 
  * this scheduler then selects another process from the ready queue to run, so the system continues operating.
  * 
  * 
@@ -359,52 +496,83 @@ HIDDEN void createProcess(state_PTR state_process, support_PTR support_process)
  * 
  * Incrementing the device semaphore directly might disrupt the intended signaling behavior for device I/O.
  * 
+ * @note
+ * The walk only keeps two pointers, so the kernel stack use is the same for a chain of 
+ * two processes or of two hundred, where the recursive version used one frame per level.
+ * 
  * @param terminate_process: the process to be terminated
  * @return void
 *********************************************************************************************/
 HIDDEN void terminateProcess(pcb_PTR terminate_process){ 
+    pcb_PTR this_process, parent_process;
+    pcb_PTR dead_queue = mkEmptyProcQ(); /* the terminated PCBs waiting to be freed */
+    int *this_semaphore;
+    int dead_count = 0;         /* how many processes were terminated */
+    int soft_blocked_count = 0; /* how many of them were blocked on a device semaphore */
+
+    /* Step 1: Make the root an orphan, the rest of the subtree goes with it */
+    outChild(terminate_process);
+
+    /* Step 2: Post-order walk of the subtree */
+    this_process = terminate_process;
+    while (this_process != NULL) {
+
+        /* Go down to the first process with no children */
+        if ( !(emptyChild(this_process)) ) {
+            this_process = this_process->p_child;
+            continue;
+        }
 
-    /* Step 1: Recursively terminate all childrn */
-    while ( !(emptyChild(terminate_process)) ) {
-        terminateProcess(removeChild(terminate_process));
-    }
+        /* this_process is a leaf: detach it, the parent is the next one to visit */
+        if (this_process == terminate_process) {
+            parent_process = NULL;
+        } else {
+            parent_process = this_process->p_prnt;
+            removeChild(parent_process);
+        }
 
-    /* Step 2: Check the position of the process using semaphore */
-    int *this_semaphore = terminate_process->p_semAdd;
+        /* Step 3: Check the position of the process using semaphore */
+        this_semaphore = this_process->p_semAdd;
 
-    /* If the process to be terminated is the current process */
-    if (terminate_process == currentProcess) {
-        
-        /* Then make it orphan by remove it from the parent to ready to free later */
-        outChild(terminate_process);
+        if (this_process == currentProcess) {
 
-    } else if (this_semaphore != NULL){ /* If the process is blocked on the ASL */
-        
-        /* Remove it from the blocked list */
-        outBlocked(terminate_process);
+            /* The current process is on no queue, it was detached in step 1 */
 
-        /* If the process is in non-device semaphores, increament the semaphore */
-        if ( ! (
-                (this_semaphore >= &semaphoreDevices[0]) && 
-                (this_semaphore <= &semaphoreDevices[CLOCK_INDEX])
-            )) { 
-                    ( *(this_semaphore) )++;
-        }
-        else {
+        } else if (this_semaphore != NULL){ /* If the process is blocked on the ASL */
+            
+            /* Remove it from the blocked list */
+            outBlocked(this_process);
 
-            /* If the process is in device semaphores, decrease the soft block */
-            softBlockedCount--;
-        } 
-    } else {
+            /* If the process is in non-device semaphores, increament the semaphore */
+            if ( ! (
+                    (this_semaphore >= &semaphoreDevices[0]) && 
+                    (this_semaphore <= &semaphoreDevices[CLOCK_INDEX])
+                )) { 
+                        ( *(this_semaphore) )++;
+            }
+            else {
+
+                /* If the process is in device semaphores, decrease the soft block (later) */
+                soft_blocked_count++;
+            } 
+        } else if (this_process->p_waitNext != NULL) { /* If the process waits on a set of semaphores */
 
-        /* If the process is not blocked, it must be in the Ready Queue */ 
-        outProcQ(&readyQueue, terminate_process);
+            cancelWaitAnyHelper(this_process, FALSE);
+        } else {
+
+            /* If the process is not blocked, it must be in the Ready Queue */ 
+            outReadyQueueHelper(this_process);
+        }
+
+        insertProcQ(&dead_queue, this_process);
+        dead_count++;
+        this_process = parent_process;
     }
 
-    /* STEP 3; Free the PCB of the terminating process */
-    freePcb(terminate_process);
-    processCount--;
-    terminate_process = NULL;
+    /* STEP 4: Free the PCBs of the terminated processes */
+    freeProcQ(&dead_queue);
+    processCount -= dead_count;
+    softBlockedCount -= soft_blocked_count;
 }
 
 
@@ -458,10 +626,18 @@ HIDDEN void passeren(int *this_semaphore){
  *
  * @protocol
  * 1. Increment the semaphore value by 1
- * 2. If the value of the semaphore is less than or equal to 0, the process must be unblocked
- * 3. update the timer for the current process and return control to current process
+ * 2. update the timer for the current process
+ * 3. If the value of the semaphore is less than or equal to 0, the process must be unblocked
+ *    (the state of the caller is saved in its pcb first)
+ *    - with SCHED_HANDOFF, it runs at once on the rest of the caller's quantum (handoffProcessHelper)
+ *    - otherwise wakeProcessHelper: with SCHED_WAKEUP_PREEMPT it may run at once, instead of the caller
  * 4. return control to the current process
  * 
+ * @note
+ * The CPU time of the caller is charged before the wake up, since the caller may be preempted.
+ * It runs before the state is saved in the pcb (see systemTrapHandler): when nobody waits,
+ * the caller is resumed from the BIOS data page without any copy.
+ * 
  * @param this_semaphore: the semaphore to be passed
  * @return void
 **********************************************************************************************/
@@ -472,23 +648,503 @@ HIDDEN void verhogen(int *this_semaphore){
 
     debugExceptionHandler(9, *this_semaphore, 0, 0); /* I WILL NOT DELETE THIS TO MEMORIZE AND REMARK IT AS ONE OF THE 4-HOUR DEBUGGING */
 
+    /* update the timer for the current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+
     if (*this_semaphore <= 0) { 
-        /* If the value of the semaphore is less than or equal to 0, the process must be unblocked */
-        pcb_PTR this_pcb = removeBlocked(this_semaphore);
+        /* If the value of the semaphore is less than or equal to 0, the process must be unblocked,
+        the caller may lose the CPU to it, so its state is saved first */
+        pcb_PTR this_pcb = claimWaiterHelper(removeBlocked(this_semaphore));
+        addPigeonCurrentProcessHelper();
 
         if (this_pcb != NULL) {
-            insertProcQ(&readyQueue, this_pcb);
+            if (schedModes & SCHED_HANDOFF) {
+                handoffProcessHelper(this_pcb);
+            }
+            wakeProcessHelper(this_pcb);
         }
+        switchContext(currentProcess);
     }
 
-    /* update the timer for the current process and return control to current process */
+    /* nobody was waiting: return control to the current process from the saved state */
+    resumeContext();
+}
+
+/*********************************************************************************************
+ * SIGNALWAIT - signalAndWait
+ * 
+ * @brief
+ * This nucleus extension performs a V on one semaphore (a1) and then a P on another (a2)
+ * in a single trap, the common "signal and wait" of a producer/consumer pair. It saves a whole
+ * exception entry, state copy and LDST over a SYS4 followed by a SYS3, and it only reschedules
+ * when the P blocks.
+ * 
+ * @protocol
+ * 1. V: Increment the first semaphore, if it is less than or equal to 0 take its waiter off the ASL
+ * 2. P: Decrement the second semaphore
+ * 3. If it is less than 0, the current process blocks on it, then:
+ *      - with SCHED_HANDOFF, the waiter runs at once on the rest of the caller's quantum,
+ *      - otherwise the waiter is made ready and the scheduler is called
+ * 4. Otherwise update the timer for the current process, make the waiter ready 
+ *    (wakeProcessHelper) and return control to the current process
+ * 
+ * @note
+ * The result is the same as SYS4 (a1) then SYS3 (a2), also when both are the same semaphore.
+ * With SCHED_HANDOFF, a ping-pong between two processes costs a single context switch per round.
+ * 
+ * @param v_semaphore: the semaphore to V (a1)
+ * @param p_semaphore: the semaphore to P (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void signalAndWait(int *v_semaphore, int *p_semaphore){
+    pcb_PTR this_pcb = NULL;
+
+    /* Step 1: V */
+    (*v_semaphore)++;
+    if (*v_semaphore <= 0) {
+        this_pcb = claimWaiterHelper(removeBlocked(v_semaphore));
+    }
+
+    /* Step 2: P */
+    (*p_semaphore)--;
+
+    /* Step 3: the caller blocks */
+    if (*p_semaphore < 0) {
+        blockCurrentProcessHelper(p_semaphore);
+        if (this_pcb != NULL) {
+            if (schedModes & SCHED_HANDOFF) {
+                handoffProcessHelper(this_pcb);
+            }
+            wakeProcessHelper(this_pcb);
+        }
+        scheduler();
+    }
+
+    /* Step 4: the caller goes on */
     STCK(curr_TOD);
     updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    if (this_pcb != NULL) {
+        wakeProcessHelper(this_pcb);
+    }
 
     /* return control to the current process */
     switchContext(currentProcess);
 }
 
+/*********************************************************************************************
+ * MULTICALL - multiCall
+ * 
+ * @brief
+ * This nucleus extension runs a batch of operations (sysop_t) in order, in a single trap:
+ * P (SYS3_NUM), V (SYS4_NUM) and get CPU time (SYS6_NUM). A process that releases several
+ * semaphores, or polls several counters, traps once instead of once per operation.
+ * The result of each operation is written back in its op_result, and the number of operations
+ * that ran is placed in v0.
+ * 
+ * @protocol
+ * For each operation, in order:
+ * 1. P: decrement the semaphore, if it is less than 0 the current process blocks on it:
+ *       the batch stops there (the P completes when the process is woken) and the scheduler is called
+ * 2. V: increment the semaphore, if it is less than or equal to 0 its waiter is made ready
+ * 3. get CPU time: update the timer of the current process and write its CPU time
+ * 4. anything else: write ERROR_CONST and stop the batch (this operation does not count as run)
+ * Then update the timer for the current process and return control to it.
+ * 
+ * @note
+ * The waiters woken by the V of a batch are only made ready: the caller is never preempted 
+ * (nor hands its quantum off) in the middle of a batch.
+ * 
+ * @param ops: the array of operations (a1)
+ * @param count: the number of operations (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void multiCall(sysop_PTR ops, int count){
+    int i;
+    int *this_semaphore;
+    pcb_PTR this_pcb;
+
+    for (i = 0; i < count; i++) {
+        this_semaphore = (int *) ops[i].op_arg;
+
+        switch (ops[i].op_code) {
+            case SYS3_NUM:
+                /* Step 1: P, the batch stops if it blocks */
+                ops[i].op_result = SUCCESS_CONST;
+                (*this_semaphore)--;
+                if (*this_semaphore < 0) {
+                    currentProcess->p_s.s_v0 = i + 1;
+                    blockCurrentProcessHelper(this_semaphore);
+                    scheduler();
+                }
+                break;
+
+            case SYS4_NUM:
+                /* Step 2: V */
+                ops[i].op_result = SUCCESS_CONST;
+                (*this_semaphore)++;
+                if (*this_semaphore <= 0) {
+                    this_pcb = claimWaiterHelper(removeBlocked(this_semaphore));
+                    if (this_pcb != NULL) {
+                        TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, this_pcb, this_pcb->p_s.s_v0, 0, 0, 0);
+                        insertReadyQueueHelper(this_pcb);
+                    }
+                }
+                break;
+
+            case SYS6_NUM:
+                /* Step 3: get CPU time */
+                STCK(curr_TOD);
+                updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+                start_TOD = curr_TOD;
+                ops[i].op_result = currentProcess->p_time;
+                break;
+
+            default:
+                /* Step 4: unknown operation */
+                ops[i].op_result = ERROR_CONST;
+                count = i;
+                break;
+        }
+    }
+    currentProcess->p_s.s_v0 = count;
+
+    /* update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    switchContext(currentProcess);
+}
+
+/*********************************************************************************************
+ * TRYP - tryPasseren
+ * 
+ * @brief
+ * This nucleus extension performs a P on a semaphore only if it does not block,
+ * so a process can poll a semaphore without waiting on it.
+ * 
+ * @protocol
+ * 1. If the value of the semaphore is greater than 0, decrement it and place SUCCESS_CONST in v0
+ * 2. Otherwise leave the semaphore unchanged and place ERROR_CONST in v0
+ * 3. update the timer for the current process and return control to current process
+ * 
+ * @note
+ * It never gives up the CPU, so it works on the saved exception state in place (see systemTrapHandler).
+ * 
+ * @param this_semaphore: the semaphore to be passed (a1)
+ * @return void
+*********************************************************************************************/
+HIDDEN void tryPasseren(int *this_semaphore){
+
+    /* Step 1 - 2: P only if the semaphore is free */
+    if (*this_semaphore > 0) {
+        (*this_semaphore)--;
+        savedExceptionState->s_v0 = SUCCESS_CONST;
+    } else {
+        savedExceptionState->s_v0 = ERROR_CONST;
+    }
+
+    /* Step 3: update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    resumeContext();
+}
+
+/*********************************************************************************************
+ * TIMEDP - timedPasseren
+ * 
+ * @brief
+ * This nucleus extension performs a P on a semaphore that gives up at a deadline (a TOD value),
+ * instead of looping on SYS7 to check the time. v0 is SUCCESS_CONST if the P completed 
+ * (right away, or by a V), ERROR_CONST if the deadline passed first.
+ * 
+ * @protocol
+ * 1. If it is a device semaphore, place ERROR_CONST in v0 and return control to the current process
+ * 2. If the semaphore is free, P it, place SUCCESS_CONST in v0 and return control to the current process
+ * 3. If the deadline has already passed, place ERROR_CONST in v0 and return control to the current process
+ * 4. Otherwise block the current process on the semaphore with its deadline (insertBlockedTimed
+ *    puts it on the sorted timeout list of the ASL), decrement the semaphore and call the scheduler.
+ *    If no semaphore descriptor can be allocated, the semaphore is left as it is and ERROR_CONST
+ *    is placed in v0, as for an expired wait, and control returns to the current process.
+ *      - A V takes it off the ASL, and off the timeout list, with SUCCESS_CONST already in v0
+ *      - The interval timer handler expires it, undoing the decrement and placing ERROR_CONST in v0
+ * 
+ * @note
+ * The deadline is checked once per pseudo-clock tick (see intervalTimerInterruptHandler).
+ * Device semaphores are rejected: they are woken with the device status in v0, and are not
+ * counted in softBlockedCount here nor undone on expiry like the other semaphores.
+ * 
+ * @param this_semaphore: the semaphore to be passed (a1)
+ * @param deadline: the TOD at which the wait gives up (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void timedPasseren(int *this_semaphore, cpu_t deadline){
+
+    STCK(curr_TOD);
+
+    if ((this_semaphore >= &semaphoreDevices[0]) && 
+        (this_semaphore <= &semaphoreDevices[CLOCK_INDEX])) {
+        /* Step 1: a device semaphore */
+        currentProcess->p_s.s_v0 = ERROR_CONST;
+    } else if (*this_semaphore > 0) {
+        /* Step 2: the semaphore is free */
+        (*this_semaphore)--;
+        currentProcess->p_s.s_v0 = SUCCESS_CONST;
+    } else if (deadline - curr_TOD <= 0) {
+        /* Step 3: too late already */
+        currentProcess->p_s.s_v0 = ERROR_CONST;
+    } else if (insertBlockedTimed(this_semaphore, currentProcess, deadline)) {
+        /* Step 4: no descriptor, the process cannot wait */
+        currentProcess->p_s.s_v0 = ERROR_CONST;
+    } else {
+        /* Step 4: block until a V or the deadline */
+        (*this_semaphore)--;
+        currentProcess->p_s.s_v0 = SUCCESS_CONST;
+        updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+        TRACE(TRACE_BLOCK, TRACE_EV_BLOCK, currentProcess, this_semaphore, 0, 0, 0);
+        currentProcess = NULL;
+        scheduler();
+    }
+
+    /* update the timer for the current process and return control to current process */
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    switchContext(currentProcess);
+}
+
+/*********************************************************************************************
+ * WAITANY - waitAny
+ * 
+ * @brief
+ * This nucleus extension waits on the first of a set of semaphores (a1, an array of a2 semaphore
+ * addresses, device semaphores included), so one process can serve several devices or 
+ * several queues. v0 is the index in the set of the semaphore that was passed, ERROR_CONST
+ * if the set is invalid. When a device semaphore is signalled, v1 holds the device status.
+ * 
+ * @protocol
+ * 1. Check the set: 1 to WAITANY_MAX semaphores, no semaphore twice
+ * 2. If one of the semaphores is free, P it (the first one in the set) and return control
+ *    to the current process with its index in v0 (and, for a device semaphore, the status of the 
+ *    completion that found no waiter in v1)
+ * 3. Otherwise register the current process on all of them (insertBlockedAny) and
+ *    P each one, counting the device semaphores as soft blocked, then call the scheduler
+ * 4. The first V (or I/O completion) wakes it: claimWaiterHelper takes it off the other
+ *    semaphores and undoes their P
+ * 
+ * @note
+ * Each registration is a proxy PCB on the semaphore queue, so a set costs as many PCBs as semaphores.
+ * 
+ * @param semaphores: the semaphore addresses (a1)
+ * @param count: how many semaphores (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void waitAny(int **semaphores, int count){
+    int i, j;
+    int device_count = 0;
+    int valid = (count >= 1 && count <= WAITANY_MAX);
+
+    /* Step 1: Check the set */
+    for (i = 1; valid && i < count; i++) {
+        for (j = 0; j < i; j++) {
+            if (semaphores[i] == semaphores[j]) {
+                valid = FALSE;
+            }
+        }
+    }
+    currentProcess->p_s.s_v0 = ERROR_CONST;
+
+    if (valid) {
+        /* Step 2: One of the semaphores is free */
+        for (i = 0; i < count && *(semaphores[i]) <= 0; i++);
+
+        if (i < count) {
+            (*(semaphores[i]))--;
+            currentProcess->p_s.s_v0 = i;
+            if ((semaphores[i] >= &semaphoreDevices[0]) && 
+                (semaphores[i] <= &semaphoreDevices[CLOCK_INDEX])) {
+                currentProcess->p_s.s_v1 = devicePendingStatus[semaphores[i] - semaphoreDevices];
+            }
+        } else if (!insertBlockedAny(semaphores, count, currentProcess)) {
+            /* Step 3: wait on all of them */
+            TRACE(TRACE_BLOCK, TRACE_EV_BLOCK, currentProcess, semaphores, 0, 0, 0);
+            for (i = 0; i < count; i++) {
+                (*(semaphores[i]))--;
+                if ((semaphores[i] >= &semaphoreDevices[0]) && 
+                    (semaphores[i] <= &semaphoreDevices[CLOCK_INDEX])) {
+                    device_count++;
+                }
+            }
+            softBlockedCount += device_count;
+            if (device_count > 0) {
+                ioWaitProcessHelper(currentProcess);
+            }
+
+            STCK(curr_TOD);
+            updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+            currentProcess = NULL;
+            scheduler();
+        }
+    }
+
+    /* update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    switchContext(currentProcess);
+}
+
+/*********************************************************************************************
+ * VN - verhogenN
+ * 
+ * @brief
+ * This nucleus extension performs n V operations on a semaphore in one trap:
+ * the semaphore grows by n and up to n of its waiters are made ready, in order.
+ * A fan-out that used to cost one SYS4 per waiter (each with its ASL search) costs
+ * a single ASL search and a single requeue (removeBlockedN).
+ * 
+ * @protocol
+ * 1. If n is less than 1, place ERROR_CONST in v0 and return control to the current process
+ * 2. Add n to the semaphore value
+ * 3. If there were waiters, move the first n of them off the ASL at once, and make them ready
+ *    (a WAITANY among them is woken through claimAllWaitersHelper)
+ * 4. Place the number of woken processes in v0, update the timer for the current process 
+ *    and return control to the current process
+ * 
+ * @note
+ * As in MULTICALL, the woken processes are only made ready: the caller is never preempted by them.
+ * 
+ * @param this_semaphore: the semaphore (a1)
+ * @param n: how many V (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void verhogenN(int *this_semaphore, int n){
+    pcb_PTR woken_queue = mkEmptyProcQ();
+    int woken_count = 0;
+
+    if (n < 1) {
+        /* Step 1: nothing to do */
+        currentProcess->p_s.s_v0 = ERROR_CONST;
+    } else {
+        /* Step 2 + 3: n V, the waiters leave in one run */
+        if (*this_semaphore < 0) {
+            woken_count = removeBlockedN(this_semaphore, &woken_queue, n);
+            claimAllWaitersHelper(&woken_queue, NULL, woken_count);
+            insertAllReadyQueueHelper(&woken_queue);
+        }
+        (*this_semaphore) += n;
+        currentProcess->p_s.s_v0 = woken_count;
+    }
+
+    /* Step 4: update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    switchContext(currentProcess);
+}
+
+/*********************************************************************************************
+ * BROADCAST - broadcast
+ * 
+ * @brief
+ * This nucleus extension releases every process waiting on a semaphore in one trap, 
+ * as many V as there are waiters: the barrier of a batch job.
+ * 
+ * @protocol
+ * 1. If the semaphore value is less than 0, move all its waiters off the ASL at once 
+ *    (wakeAllBlockedHelper), make them ready, and set the semaphore value to 0
+ * 2. Place the number of woken processes in v0, update the timer for the current process 
+ *    and return control to the current process
+ * 
+ * @param this_semaphore: the semaphore (a1)
+ * @return void
+*********************************************************************************************/
+HIDDEN void broadcast(int *this_semaphore){
+    int woken_count = 0;
+
+    /* Step 1: every waiter leaves in one splice */
+    if (*this_semaphore < 0) {
+        woken_count = wakeAllBlockedHelper(this_semaphore, FALSE, NO_IRQ, 0);
+        *this_semaphore = 0;
+    }
+
+    /* Step 2: update the timer for the current process and return control to current process */
+    currentProcess->p_s.s_v0 = woken_count;
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    switchContext(currentProcess);
+}
+
+/*********************************************************************************************
+ * IRQSTATS - getIrqStats
+ * 
+ * @brief
+ * This nucleus extension copies the interrupt latency statistics (irqStats, an irqstats_t) 
+ * to the caller: per interrupt line and per device semaphore, the count, total, min, max and
+ * log2 histogram of the time from the interrupt entry to the acknowledge, and to the dispatch 
+ * of the process it woke. It is what the time slices are sized with.
+ * 
+ * @protocol
+ * 1. If the destination is NULL, place ERROR_CONST in v0, otherwise copy the statistics word 
+ *    by word, clear them if asked to (initIrqStatsHelper), and place SUCCESS_CONST in v0
+ * 2. update the timer for the current process and return control to the current process,
+ *    from the saved state (like SYS6, it never blocks)
+ * 
+ * @param stats: where to copy the statistics (a1)
+ * @param clear: TRUE to start new statistics after the copy (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void getIrqStats(irqstats_t *stats, int clear){
+    int *from = (int *) &irqStats;
+    int *to = (int *) stats;
+    int i;
+
+    /* Step 1: copy the statistics */
+    savedExceptionState->s_v0 = ERROR_CONST;
+    if (stats != NULL) {
+        for (i = 0; i < (int) (sizeof(irqstats_t) / WORDLEN); i++) {
+            to[i] = from[i];
+        }
+        if (clear) {
+            initIrqStatsHelper();
+        }
+        savedExceptionState->s_v0 = SUCCESS_CONST;
+    }
+
+    /* Step 2: update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    resumeContext();
+}
+
+/*********************************************************************************************
+ * TRACECTL - setTraceMask
+ * 
+ * @brief
+ * This nucleus extension sets which classes of events the kernel trace records (traceMask,
+ * see trace.c): TRACE_SWITCH, TRACE_SYSCALL, TRACE_BLOCK, TRACE_INTERRUPT, TRACE_DEBUG.
+ * The previous mask is placed in v0, so a caller can turn the trace on around a section and
+ * put it back. 0 turns the trace off.
+ * 
+ * @protocol
+ * 1. Place the previous mask in v0 and set the new one (the unknown bits are dropped).
+ *    If the new one drops TRACE_SYSCALL, forget the entry of this very call: its exit is not 
+ *    recorded (resumeContext may skip traceDispatchHelper), it would come out stale once re-enabled
+ * 2. update the timer for the current process and return control to the current process,
+ *    from the saved state (like SYS6, it never blocks)
+ * 
+ * @param mask: the new mask (a1)
+ * @return void
+*********************************************************************************************/
+HIDDEN void setTraceMask(int mask){
+    /* Step 1: switch the mask */
+    savedExceptionState->s_v0 = traceMask;
+    traceMask = mask & TRACE_ALL;
+    if (!(traceMask & TRACE_SYSCALL)) {
+        currentProcess->p_traceSys = 0;
+    }
+
+    /* Step 2: update the timer for the current process and return control to current process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+    resumeContext();
+}
+
 /*********************************************************************************************
  * SYS5 - waitForIO
  * 
@@ -499,17 +1155,19 @@ HIDDEN void verhogen(int *this_semaphore){
  * @protocol
  * 1. Find the index of the semaphore associated with the device requesting I/O in semaphoreDevices[].
  * 2. check if the process is waiting for a terminal read operation or write operation
- * 3. Decrement the semaphore value by 1 and increment the soft block count
- * 4. If the value of the semaphore is less than 0, the process must be blocked
- * 5. update the timer for the current process and return control to current process
+ * 3. Decrement the semaphore value by 1
+ * 4. If the value of the semaphore is less than 0, the process must be blocked: increment the 
+ *    soft block count (the scheduling policy is told first, e.g. MLFQ puts it back on the top level)
+ * 5. Otherwise the completion already came (kept by deviceWorkHelper, see cancelWaitAnyHelper):
+ *    place its status in v0, update the timer for the current process and return control to current process
  * 
  * 
  * @note
  * IMPORTANT:
  * Since the semaphore that will have a P operation performed on it is a synchronization semaphore, 
  * this call should always block the Current Process on the ASL, after which the Scheduler is called.
- * Therefore, we expect that step 5 is NOT execute. However, for the best coding practice, I implemented
- * an "if" statement to check on the value of the semaphore.
+ * The exception is a completion that found no waiter (a WAITANY woken by another semaphore of its set 
+ * gave its P back): then the semaphore is 1 and step 5 returns the kept status at once.
  * 
  * @note
  * - A common way to “calculate” the semaphore is by using an index like:
@@ -535,18 +1193,21 @@ HIDDEN void waitForIO(int interrupt_line_number, int device_number, int wait_for
         semaphore_index += DEVPERINT; 
     }
 
-    /* Step 3: Decrease semaphore and increase soft block count */
-    softBlockedCount++;
+    /* Step 3: Decrease semaphore */
     (semaphoreDevices[semaphore_index])--;
     
 
-    /* Step 4: If the value of the semaphore is less than 0, the process must be blocked */
+    /* Step 4: If the value of the semaphore is less than 0, the process must be blocked,
+    the policy is told that it waits for I/O */
     if (semaphoreDevices[semaphore_index] < 0) { 
+        softBlockedCount++;
+        ioWaitProcessHelper(currentProcess);
         blockCurrentProcessHelper(&semaphoreDevices[semaphore_index]);
         scheduler();
     }
 
-    /* Step 5: update the timer for the current process and return control to current process */
+    /* Step 5: the completion came first, update the timer for the current process and return control to current process */
+    currentProcess->p_s.s_v0 = devicePendingStatus[semaphore_index];
     STCK(curr_TOD);
     updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
 
@@ -564,7 +1225,8 @@ HIDDEN void waitForIO(int interrupt_line_number, int device_number, int wait_for
  * @protocol
  * 1. The function places the accumulated processor time used by the requesting process in v0.
  * 3. The function then add the syscall CPU time to the current process time
- * 4. The function then returns control to the Current Process by loading its (updated) processor state. 
+ * 4. The function then returns control to the Current Process by loading its (updated) processor state,
+ *    straight from the BIOS data page (see systemTrapHandler). 
  * 
  * @note
  *          start_tod
@@ -598,14 +1260,14 @@ HIDDEN void getCPUTime(){
     /* Step 1: The function places the accumulated processor time used by the requesting process in v0 */
     STCK(curr_TOD);
     updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
-    currentProcess->p_s.s_v0 = currentProcess->p_time;
+    savedExceptionState->s_v0 = currentProcess->p_time;
 
     /* Step 2: update the syscall CPU time for this process */
     STCK(curr_TOD);
     updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
 
-    /* Step 3: return control to the current process */
-    switchContext(currentProcess);
+    /* Step 3: return control to the current process, from the saved state */
+    resumeContext();
 }
 
 /*********************************************************************************************
@@ -620,6 +1282,7 @@ HIDDEN void getCPUTime(){
  * @protocol
  * 1. Decrement the semaphore value by 1.
  * 2. If the value of the semaphore is less than 0, the process must be blocked.
+ *    Like for I/O, the scheduling policy is told first (e.g. MLFQ puts it back on the top level).
  * 3. If the value of the semaphore is greater than or equal to 0, the process can continue.
  * 
  * @note
@@ -639,6 +1302,7 @@ HIDDEN void waitForClock(){
     /* STEP 2: If the value of the semaphore is less than 0, the process must be blocked */
     if (semaphoreDevices[CLOCK_INDEX] < 0) { 
         softBlockedCount++;
+        ioWaitProcessHelper(currentProcess);
         blockCurrentProcessHelper(&semaphoreDevices[CLOCK_INDEX]);
         scheduler();
     }
@@ -661,20 +1325,96 @@ HIDDEN void waitForClock(){
  * @protocol
  * 1. The function places the current process' supportStruct in v0.
  * 2. The function then add the syscall CPU time to the current process time
+ * 3. Return control to the current process straight from the BIOS data page (see systemTrapHandler)
  * 
  * @param void
  * @return void
 *********************************************************************************************/
 HIDDEN void getSupportData() {
     /* Step 1: The function place the support Struct in v0 */
-    currentProcess->p_s.s_v0 = (int)(currentProcess->p_supportStruct); 
+    savedExceptionState->s_v0 = (int)(currentProcess->p_supportStruct); 
 
     /* Step 2: update the syscall CPU time for this process */
     STCK(curr_TOD); 
     updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
     
+    /* return control to the current process, from the saved state */
+    resumeContext(); 
+}
+
+/*********************************************************************************************
+ * SETSCHED - setScheduler
+ * 
+ * @brief
+ * This nucleus extension selects the scheduling policy at run time (SCHED_RR, SCHED_MLFQ,
+ * SCHED_PRIORITY or SCHED_CFS, see policy.c) and the scheduling modes (SCHED_WAKEUP_PREEMPT,
+ * SCHED_HANDOFF).
+ * The ready processes are moved from the old policy to the new one. The previous policy 
+ * is placed in v0, or -1 if the policy or a mode is unknown.
+ * 
+ * @protocol
+ * 1. Switch the policy and modes (setSchedPolicy) and place the previous policy in v0
+ * 2. update the timer for the current process
+ * 3. If the policy is unknown, return control to the current process
+ * 4. Otherwise the current process yields, so the new policy decides who runs next
+ * 
+ * @param policy: the policy to select (a1)
+ * @param modes: the modes to select (a2)
+ * @return void
+*********************************************************************************************/
+HIDDEN void setScheduler(int policy, int modes) {
+    /* Step 1: switch the policy */
+    currentProcess->p_s.s_v0 = setSchedPolicy(policy, modes);
+
+    /* Step 2: update the syscall CPU time for this process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+
+    /* Step 3: unknown policy, nothing changed */
+    if (currentProcess->p_s.s_v0 == ERROR_CONST) {
+        switchContext(currentProcess);
+    }
+
+    /* Step 4: yield to the new policy */
+    yieldProcessHelper(currentProcess);
+    currentProcess = NULL;
+    scheduler();
+}
+
+/*********************************************************************************************
+ * SETPRIO - setPriority
+ * 
+ * @brief
+ * This nucleus extension sets the static priority of the current process (0 is the highest,
+ * PRIO_LEVELS - 1 the lowest). The static priority policy dispatches the higher priorities first,
+ * the completely fair one gives them a larger share of the CPU. The children created afterwards
+ * inherit it. The previous priority is placed in v0, or -1 if the priority is unknown.
+ * 
+ * @protocol
+ * 1. If the priority is known, place the previous one in v0 and set it, otherwise place -1 in v0
+ * 2. update the timer for the current process and return control to the current process
+ * 
+ * @note
+ * The current process is on no ready queue, so its priority can change without moving it.
+ * 
+ * @param priority: the new priority (a1)
+ * @return void
+*********************************************************************************************/
+HIDDEN void setPriority(int priority) {
+    /* Step 1: set the priority */
+    if (priority >= 0 && priority < PRIO_LEVELS) {
+        currentProcess->p_s.s_v0 = currentProcess->p_priority;
+        currentProcess->p_priority = priority;
+    } else {
+        currentProcess->p_s.s_v0 = ERROR_CONST;
+    }
+
+    /* Step 2: update the syscall CPU time for this process */
+    STCK(curr_TOD);
+    updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
+
     /* return control to the current process */
-    switchContext(currentProcess); 
+    switchContext(currentProcess);
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -859,8 +1599,15 @@ void tlbTrapHandler(){
  *      - Invoke the programTrapHandler
  * 2. Check if the syscall number is in range
  *      - If the syscall number is not in range, we need to pass up or die thru sysCallOutRangeHandler
- * 3. Add the state to the current process
- * 3. Call the appropriate syscall function
+ * 3. The syscalls that may leave the caller running on the spot (SYS4, SYS6, SYS8, TRYP, IRQSTATS, TRACECTL)
+ *    run first, on the saved exception state: they return (resumeContext) straight from the
+ *    BIOS data page, and save the state in the pcb only if the caller gives up the CPU
+ * 4. Add the state to the current process
+ * 5. Call the appropriate syscall function
+ * 
+ * @note
+ * While a process runs after such a syscall, its p_s is stale: it is only brought up to date
+ * when the process leaves the CPU (addPigeonCurrentProcessHelper).
  * 
  * @param void
  * @return void
@@ -883,20 +1630,51 @@ void systemTrapHandler() {
         userModeTrapHandler();
     }
 
-    /* STEP 2: check if the syscall number is in range */
-    if ((sysCallNum < SYS1_NUM )|| (sysCallNum > SYS8_NUM)) {
+    /* STEP 2: check if the syscall number is in range (SYS1-SYS8 or a negative nucleus extension) */
+    if ((sysCallNum < SYSEXT_MIN_NUM) || (sysCallNum == 0) || (sysCallNum > SYS8_NUM)) {
         sysCallOutRangeHandler();
     }
 
-    /* STEP 3: add the state to the current process */
+    /* record the entry, its exit is recorded when the caller runs again (traceDispatchHelper) */
+    if (traceMask & TRACE_SYSCALL) {
+        currentProcess->p_traceSys = sysCallNum;
+        traceHelper(TRACE_EV_SYSCALL, currentProcess, sysCallNum, savedExceptionState->s_a1,
+                    savedExceptionState->s_a2, savedExceptionState->s_a3);
+    }
+
+    /* STEP 3: the syscalls that work on the saved state in place, no return if they are taken */
+    switch (sysCallNum) {
+        case SYS4_NUM:
+            verhogen((int *)(savedExceptionState->s_a1));
+            break;
+        case SYS6_NUM:
+            getCPUTime();
+            break;
+        case SYS8_NUM:
+            getSupportData();
+            break;
+        case TRYP_NUM:
+            tryPasseren((int *)(savedExceptionState->s_a1));
+            break;
+        case IRQSTATS_NUM:
+            getIrqStats((irqstats_t *)(savedExceptionState->s_a1),
+                        savedExceptionState->s_a2);
+            break;
+        case TRACECTL_NUM:
+            setTraceMask(savedExceptionState->s_a1);
+            break;
+    }
+
+    /* STEP 4: add the state to the current process */
     addPigeonCurrentProcessHelper(currentProcess);
  
-    /* STEP 4: Call the appropriate syscall function */
+    /* STEP 5: Call the appropriate syscall function */
     switch (sysCallNum) {
         case SYS1_NUM:
             createProcess(
                 (state_PTR)(currentProcess->p_s.s_a1),
-                (support_PTR)(currentProcess->p_s.s_a2));
+                (support_PTR)(currentProcess->p_s.s_a2),
+                currentProcess->p_s.s_a3);
             break;
         case SYS2_NUM:
             terminateProcess(currentProcess);
@@ -906,22 +1684,42 @@ void systemTrapHandler() {
         case SYS3_NUM:
             passeren((int *)(currentProcess->p_s.s_a1));
             break;
-        case SYS4_NUM:
-            verhogen((int *)(currentProcess->p_s.s_a1));
-            break;
         case SYS5_NUM:
             waitForIO(currentProcess->p_s.s_a1,
                       currentProcess->p_s.s_a2,
                       currentProcess->p_s.s_a3);
             break;
-        case SYS6_NUM:
-            getCPUTime();
-            break;
         case SYS7_NUM:
             waitForClock();
             break;
-        case SYS8_NUM:
-            getSupportData();
+        case SETSCHED_NUM:
+            setScheduler(currentProcess->p_s.s_a1, currentProcess->p_s.s_a2);
+            break;
+        case SETPRIO_NUM:
+            setPriority(currentProcess->p_s.s_a1);
+            break;
+        case SIGNALWAIT_NUM:
+            signalAndWait((int *)(currentProcess->p_s.s_a1),
+                          (int *)(currentProcess->p_s.s_a2));
+            break;
+        case MULTICALL_NUM:
+            multiCall((sysop_PTR)(currentProcess->p_s.s_a1),
+                      currentProcess->p_s.s_a2);
+            break;
+        case TIMEDP_NUM:
+            timedPasseren((int *)(currentProcess->p_s.s_a1),
+                          (cpu_t)(currentProcess->p_s.s_a2));
+            break;
+        case WAITANY_NUM:
+            waitAny((int **)(currentProcess->p_s.s_a1),
+                    currentProcess->p_s.s_a2);
+            break;
+        case VN_NUM:
+            verhogenN((int *)(currentProcess->p_s.s_a1),
+                      currentProcess->p_s.s_a2);
+            break;
+        case BROADCAST_NUM:
+            broadcast((int *)(currentProcess->p_s.s_a1));
             break;
     
     }
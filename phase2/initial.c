@@ -36,16 +36,20 @@
 
 #include "../h/initial.h"
 #include "../h/scheduler.h"
+#include "../h/policy.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/trace.h"
 #include "../h/types.h"
 #include "../h/const.h"
 #include "../h/asl.h"
 #include "../h/pcb.h"
+#include "../h/frame.h"
 #include "/usr/include/umps3/umps/libumps.h"
 
 
 extern void test();
+extern char _end[]; /* end of the kernel image, provided by the linker script */
 extern void uTLB_RefillHandler(); /* function declaration for uTLB_RefillHandler(), which will be defined in exceptions.c */
 
 /* ------------------------------------------------------ */
@@ -58,15 +62,16 @@ int processCount;
 /* Count the current number of soft blocked process in the system */
 int softBlockedCount;
 
-/* The ready queue is a list of PCBs that are ready to run */
-pcb_PTR readyQueue;
-
 /* The current process is the process that is currently running */
 pcb_PTR currentProcess;
 
 /* The device semaphores are used to manage access to the devices */
 int semaphoreDevices[MAX_DEVICE_COUNT];
 
+/* The status of the last completion of each device that found no process waiting for it,
+handed to the next P on its semaphore (SYS5, WAITANY) */
+unsigned int devicePendingStatus[MAX_DEVICE_COUNT];
+
 /* The start time of the current process */
 cpu_t start_TOD;
 
@@ -79,6 +84,9 @@ cpu_t interrupt_TOD;
 /* the exception processor state to handle */
 state_PTR savedExceptionState;
 
+/* The interrupt latency statistics (kernel statistics area, read with IRQSTATS) */
+irqstats_t irqStats;
+
 
 
 
@@ -93,6 +101,7 @@ state_PTR savedExceptionState;
  * @brief
  * Debug function for exception handling. Accepts four integer parameters that can be viewed
  * in registers a0-a3 when a breakpoint is set on this function.
+ * With TRACE_DEBUG on, the call is also recorded on the kernel trace (trace.c).
  * 
  * @param key - Unique identifier showing where in the code this debug call happens
  * @param param1 - First parameter (typically exception code)
@@ -101,7 +110,9 @@ state_PTR savedExceptionState;
  * 
  * @return void
 ***********************************************************************************************/
-void debugExceptionHandler(int key, int param1, int param2, int param3) {}
+void debugExceptionHandler(int key, int param1, int param2, int param3) {
+    TRACE(TRACE_DEBUG, TRACE_EV_DEBUG, currentProcess, key, param1, param2, param3);
+}
 
 /************************************************************************************************
  * initPassUpVector
@@ -194,10 +205,63 @@ void initDeviceSemaphoresHelper() {
     int i;
     for (i = 0; i < MAX_DEVICE_COUNT; i++) {
         semaphoreDevices[i] = 0;
+        devicePendingStatus[i] = 0;
+    }
+}
+
+/*********************************************************************************************
+ * initIrqStatsHelper
+ * 
+ * @brief
+ * This function is used to clear the interrupt latency statistics, at boot 
+ * and when IRQSTATS is asked to.
+ * 
+ * @protocol
+ * 1. Set every word of irqStats to 0 (no samples, so l_min is taken from the first one)
+ * 
+ * @param void
+ * @return void
+ ***********************************************************************************************/
+void initIrqStatsHelper() {
+    int *word = (int *) &irqStats;
+    int i;
+    for (i = 0; i < (int) (sizeof(irqstats_t) / WORDLEN); i++) {
+        word[i] = 0;
     }
 }
 
 
+/*********************************************************************************************
+ * initFramePoolHelper
+ * 
+ * @brief
+ * This function hands the free RAM to the frame pool, so the PCB and semaphore descriptor
+ * pools can grow past MAXPROC when they run out.
+ * 
+ * @protocol
+ * 1. Find the top of the RAM from the bus register area (RAMTOP = rambase + ramsize)
+ * 2. Give the frame pool everything between the end of the kernel image and RAMTOP,
+ *    except the STACK_RESERVE_SIZE bytes right below RAMTOP
+ * 
+ * @note
+ * The stacks of the processes started by the test grow down from RAMTOP, 
+ * that is why the top of the RAM is kept out of the pool.
+ * 
+ * @param void
+ * @return void
+ ***********************************************************************************************/
+void initFramePoolHelper() {
+    devregarea_t *device_register_area;
+    device_register_area = (devregarea_t *) RAMBASEADDR;
+
+    /* Step 1: RAMTOP */
+    memaddr ram_top = device_register_area->rambase + device_register_area->ramsize;
+
+    /* Step 2: the frames between the kernel image and the process stacks */
+    initFrames((memaddr) _end, ram_top - STACK_RESERVE_SIZE);
+}
+
+
 /* ---------------------------------------------------------------------------------------------- */
 /* ------------------------------------------ MAIN :) ------------------------------------------- */
 /* ---------------------------------------------------------------------------------------------- */
@@ -219,13 +283,13 @@ void initDeviceSemaphoresHelper() {
  * @protocol
  * (Pandos page 19-22)
  * 1. Initialize the pass up vector
- * 2. Initialize the process control blocks (PCBs)
+ * 2. Initialize the frame pool, then the process control blocks (PCBs)
  * 3. Initialize the active semaphore list (ASL)
  * 4. Initialize the process count to 0
  * 5. Initialize the soft blocked count to 0
- * 6. Create an empty ready queue
+ * 6. Create the empty ready queues of every scheduling policy and select the default one
  * 7. Set the current process to NULL
- * 8. Initialize the device semaphores
+ * 8. Initialize the device semaphores and the interrupt statistics
  * 9. Load the interval timer with the value of PSECOND (100000)
  * 10. Allocate a new process and set its initial state
  *      - Set the stack pointer to the top of the RAM
@@ -233,6 +297,7 @@ void initDeviceSemaphoresHelper() {
  *      - Enable interrupts
  *      - Insert the new process into the ready queue
  *      - Increment the process count
+ * 11. Start the trace drain process (initTraceDrain), if TRACE_DRAIN names a device
  * 
  * @def
  * - Pass Up Vector is part of the BIOS Data Page, and for Processor 0, 
@@ -261,7 +326,8 @@ void main() {
     /* Step 1: init the pass up vector */
     initPassUpVector();
 
-    /* step 1+3: init PCB and ACL */
+    /* step 1+3: init the frame pool, then PCB and ACL (which grow from it) */
+    initFramePoolHelper();
     initPcbs();
     initASL();
 
@@ -269,11 +335,12 @@ void main() {
     /* Step 4 5 6 7: init the process count */
     processCount = 0;
     softBlockedCount = 0;
-    readyQueue = mkEmptyProcQ();
+    initSchedPolicy();
     currentProcess = NULL;
     
-    /* Step 8: init the device semaphores */
+    /* Step 8: init the device semaphores and the interrupt statistics */
     initDeviceSemaphoresHelper();
+    initIrqStatsHelper();
 
     /* Step 9: load the interval timer with the value of PSECOND (100000)
     this can be use for scheduling */
@@ -296,8 +363,11 @@ void main() {
         new_process->p_s.s_status = ALLOFF | IEPON | PLTON | IMON;
         
         /* insert the new process into the ready queue */
-        insertProcQ(&readyQueue, new_process);
+        insertReadyQueueHelper(new_process);
         processCount++;
+
+        /* Step 11: the trace drain, if the build asks for one */
+        initTraceDrain();
         scheduler();
     }
 
@@ -30,11 +30,18 @@
  * @note
  * There are 2 important things to remember:
  * 1. After handling the interrupt, the current process brings the exception state back (that's why I use addPigeonCurrentProcessHelper()
- * because I feel like it is a pigeon that brings the exception state back) to notify the system that the interrupt is handled
+ * because I feel like it is a pigeon that brings the exception state back) to notify the system that the interrupt is handled.
+ * The pigeon only flies when the current process gives up the CPU (PLT, or a preempting wake up): 
+ * otherwise it is resumed straight from the BIOS Data Page (resumeContext), without copying its state.
  * 2. The cpu_time of the interrupted is charged to the interrupting process, not the current process. 
  * What this file does is update the cpu_time of the current process by 
  * adding the cpu time of the current process with: (interrupt_TOD - start_TOD) -> time from the current process 
  * to the interrupt start handler
+ * 3. Device interrupts are split into top halves (deviceInterruptHelper: acknowledge and record) and 
+ * a bottom half (deviceWorkHelper: V and wake up). The split gets every device acknowledged, and
+ * restarted, before any process is woken; it does NOT shorten the interrupts-off window. 
+ * The bottom half still runs in the same handler, with the interrupts off: the nucleus is not reentrant 
+ * (one BIOS Data Page, one savedExceptionState), so it cannot take an interrupt while it works.
  * 
  * @author
  * JaWeee Do
@@ -42,8 +49,10 @@
 
 #include "../h/initial.h"
 #include "../h/scheduler.h"
+#include "../h/policy.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/trace.h"
 #include "../h/types.h"
 #include "../h/const.h"
 #include "../h/asl.h"
@@ -54,7 +63,6 @@
 HIDDEN void PLTInterruptHandler();
 HIDDEN void intervalTimerInterruptHandler();
 HIDDEN void nonTimerInterruptHandler();
-HIDDEN int findInterruptDevice(int interrupt_line_number);
 
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -64,6 +72,40 @@ HIDDEN int findInterruptDevice(int interrupt_line_number);
 /* Calculate the remaining time in the time slice of the current process */
 cpu_t current_process_time_left; 
 
+/* The index of the lowest set bit of every 8-bit value (entry 0, no bit set, is 0):
+it decodes a line's device bit map, or the device lines of the Cause IP field, in one lookup */
+const unsigned char lowestBitTable[256] = {
+    0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x00 - 0x0F */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x10 - 0x1F */
+    5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x20 - 0x2F */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x30 - 0x3F */
+    6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x40 - 0x4F */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x50 - 0x5F */
+    5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x60 - 0x6F */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x70 - 0x7F */
+    7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x80 - 0x8F */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0x90 - 0x9F */
+    5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0xA0 - 0xAF */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0xB0 - 0xBF */
+    6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0xC0 - 0xCF */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0xD0 - 0xDF */
+    5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,   /* 0xE0 - 0xEF */
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0    /* 0xF0 - 0xFF */
+};
+
+/* Round-robin among the devices: the device each line's scan starts from next time, 
+and the line the next scan starts from (0 is line 3) */
+HIDDEN int nextDevice[DEVINTNUM];
+HIDDEN int nextLine;
+
+/* Most devices served per line in one interrupt */
+HIDDEN const int lineWeight[DEVINTNUM] = DEVICE_LINE_WEIGHTS;
+
+/* The deferred device work (bottom halves): a ring of completions, in the order they were acknowledged */
+HIDDEN devwork_t workQueue[DEVICE_WORK_SIZE];
+HIDDEN int workHead;   /* the oldest completion */
+HIDDEN int workCount;  /* how many completions wait */
+
 /* ---------------------------------------------------------------------------------------------- */
 /* ------------------------------------------ INTERRUPT ----------------------------------------- */
 /* ---------------------------------------------------------------------------------------------- */
@@ -73,14 +115,14 @@ cpu_t current_process_time_left;
  * 
  * @brief
  * function is used to find the device that generated the interrupt.
- * The function takes the interrupt line number as an argument and returns the device 
+ * The function takes the device bit map of an interrupt line (not empty) as an argument and returns the device 
  * number with highest priority (smallest number).
  *
  * @protocol
- * This function first retrieve the Device Interrupt area that is saved in address 0x10000000.
- * Using the interrupt line number, it accesses the corresponding device bit map.
- * There are 5 lines of interrupts, indexing from 3 to 7, so we subtract the BASE_LINE from the line number. 
- * It then checks the status of each device on the specified interrupt line by using bitwise operations.
+ * The caller reads the bit map from the Device Interrupt area that is saved in address 0x10000000.
+ * There are 5 lines of interrupts, indexing from 3 to 7, so it subtracts the BASE_LINE from the line number. 
+ * This function then looks the lowest set bit up in lowestBitTable, instead of testing the 8 device bits
+ * one by one. It is not HIDDEN, so the Support Level drivers decode their bit maps the same way.
  * 
  * @note
  * Bitmap:
@@ -95,44 +137,129 @@ cpu_t current_process_time_left;
  * which is essentially a "API" :)? of hardware memory locations used for device management and system control.
  * Casting devregarea_t * creates a structured view of the memory at RAMBASEADDR, which is 0x10000000
  * 
- * @param interrupt_line_number: the line number of the interrupt
+ * @param device_bit_map: the device bit map of the interrupt line
  * @return int: the device number
 *********************************************************************************************/
-int findInterruptDevice(int interrupt_line_number){
+int findInterruptDevice(unsigned int device_bit_map){
 
-    /* tells the compiler to interpret the memory starting at RAMBASEADDR as a structure of type devregarea_t */
-    devregarea_t *device_register_area;
-    device_register_area = (devregarea_t *) RAMBASEADDR;
-
-    /* get the device bit map from the interrupt_dev address */
-    unsigned int device_bit_map = device_register_area->interrupt_dev[interrupt_line_number - BASE_LINE];
-
-    /* check the device bit map to find the device that generated the interrupt */
-    if ( (device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_0) != ALLOFF) {
-        return DEVICE_0;
-    } 
-     if ( (device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_1) != ALLOFF) {
-        return DEVICE_1;
-    } 
-     if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_2) != ALLOFF) {
-        return DEVICE_2;
-    } 
-     if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_3) != ALLOFF) {
-        return DEVICE_3;
-    } 
-     if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_4) != ALLOFF) {
-        return DEVICE_4;
-    } 
-     if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_5) != ALLOFF) {
-        return DEVICE_5;
-    } 
-     if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_6) != ALLOFF) {
-        return DEVICE_6;
+    /* the lowest set bit of the bit map, in one lookup */
+    return lowestBitTable[device_bit_map & A8_BITS_ON];
+}
+
+
+/*********************************************************************************************
+ * nextBitHelper
+ * 
+ * @brief
+ * This function returns the first set bit of a bit map of width bits, in round-robin order
+ * starting from bit start: the bit map is rotated right by start, looked up in lowestBitTable 
+ * and the index rotated back.
+ * 
+ * @param bits: the bit map (not empty, at most 8 bits)
+ * @param start: the bit to start from
+ * @param width: the width of the bit map (5 lines or 8 devices)
+ * @return int: the index of the bit
+*********************************************************************************************/
+HIDDEN int nextBitHelper(unsigned int bits, int start, int width) {
+    unsigned int rotated = ((bits >> start) | (bits << (width - start))) & ((1 << width) - 1);
+
+    return (lowestBitTable[rotated] + start) % width;
+}
+
+/*********************************************************************************************
+ * latencyHelper
+ * 
+ * @brief
+ * This function adds one latency sample to a statistics entry (irqStats):
+ * count, total, min, max, and its log2 histogram bucket.
+ * 
+ * @note
+ * Bucket b counts the samples in [2^b, 2^(b+1)) microseconds (bucket 0 also counts 0),
+ * the last bucket everything longer.
+ * 
+ * @param stat: the statistics entry
+ * @param latency: the sample, in microseconds
+ * @return void
+ ***********************************************************************************************/
+HIDDEN void latencyHelper(latstat_t *stat, cpu_t latency) {
+    int bucket = 0;
+    cpu_t rest = latency;
+
+    if (stat->l_count == 0 || latency < stat->l_min) {
+        stat->l_min = latency;
+    }
+    if (latency > stat->l_max) {
+        stat->l_max = latency;
     }
+    stat->l_count++;
+    stat->l_total += latency;
 
-    return DEVICE_7;
+    while (rest > 1 && bucket < IRQ_HIST_BUCKETS - 1) {
+        rest >>= 1;
+        bucket++;
+    }
+    stat->l_hist[bucket]++;
 }
 
+/*********************************************************************************************
+ * irqLineHelper
+ * 
+ * @brief
+ * This function gives the interrupt line of a device semaphore index: 
+ * the terminal transmitters (after the 5 lines of receivers) are on line 7, 
+ * the pseudo-clock on line 2.
+ * 
+ * @param device_index: the device semaphore index (semaphoreDevices)
+ * @return int: the line number
+ ***********************************************************************************************/
+HIDDEN int irqLineHelper(int device_index) {
+    if (device_index == CLOCK_INDEX) {
+        return LINE2;
+    }
+    if (device_index >= DEVINTNUM * DEVPERINT) {
+        return LINE7;
+    }
+    return (device_index / DEVPERINT) + BASE_LINE;
+}
+
+/*********************************************************************************************
+ * irqAckHelper
+ * 
+ * @brief
+ * This function records the time from the interrupt entry to the acknowledge of a device
+ * (its line and its semaphore index), and stamps the TOD for the next sample.
+ * 
+ * @param device_index: the device semaphore index (semaphoreDevices)
+ * @return void
+ ***********************************************************************************************/
+HIDDEN void irqAckHelper(int device_index) {
+    STCK(curr_TOD);
+    latencyHelper(&irqStats.st_lineAck[irqLineHelper(device_index)], curr_TOD - interrupt_TOD);
+    latencyHelper(&irqStats.st_deviceAck[device_index], curr_TOD - interrupt_TOD);
+}
+
+/*********************************************************************************************
+ * irqDispatchHelper
+ * 
+ * @brief
+ * This function is called on every dispatch (switchContext). If the process was woken by an 
+ * interrupt, it records the time from that interrupt entry to now (its line and its semaphore index).
+ * 
+ * @param process: the process being dispatched
+ * @return void
+ ***********************************************************************************************/
+void irqDispatchHelper(pcb_PTR process) {
+    cpu_t now_TOD;
+
+    if (process->p_irqIndex == NO_IRQ) {
+        return;
+    }
+
+    STCK(now_TOD);
+    latencyHelper(&irqStats.st_lineDispatch[irqLineHelper(process->p_irqIndex)], now_TOD - process->p_irqTOD);
+    latencyHelper(&irqStats.st_deviceDispatch[process->p_irqIndex], now_TOD - process->p_irqTOD);
+    process->p_irqIndex = NO_IRQ;
+}
 
 /*********************************************************************************************
  * PLTInterruptHandler
@@ -142,14 +269,16 @@ int findInterruptDevice(int interrupt_line_number){
  * The Scheduler will load the PLT with the value of 5 milliseconds (Pandos page 43)
  * 
  * @protocol
- * 1. Acknowledge the PLT interrupt by reloading the timer with 5 milliseconds.
+ * 1. Acknowledge the PLT interrupt by reloading the timer with 5 milliseconds (line 1 of the ack statistics).
  *   This tells the hardware that the interrupt has been handled.
+ *   (The scheduler loads the actual quantum of the next process.)
  * 2. Copy the processor state from the BIOS Data Page (saved during the exception)
  *  into the current process's PCB.
  * 3. Update the accumulated CPU time for the current process.
  * Here we get the current time-of-day and add the elapsed time to the process's total.
  * 4. Transition the current process from the "running" state to the "ready" state
- * by inserting it into the ready queue.
+ * through the scheduling policy, which knows it used its whole quantum 
+ * (e.g. MLFQ demotes it one level).
  * 5. Call the scheduler to choose the next process to run.
  * 
  * @param void
@@ -162,6 +291,8 @@ void PLTInterruptHandler() {
 
         /* Step 1: Acknowledge the PLT interrupt by reloading the timer with 5 milliseconds. */
         setTIMER(PLT_TIME_SLICE);
+        STCK(curr_TOD);
+        latencyHelper(&irqStats.st_lineAck[LINE1], curr_TOD - interrupt_TOD);
         /* setTIMER(INF_TIME); */
 
         /* Step 2: Copy the processor state from the BIOS Data Page */
@@ -171,8 +302,9 @@ void PLTInterruptHandler() {
         STCK(curr_TOD);
         updateProcessTimeHelper(currentProcess, start_TOD, curr_TOD);
 
-        /* STEP 4: Transition the current process from the "running" state to the "ready" state */
-        insertProcQ(&readyQueue, currentProcess);
+        /* STEP 4: Transition the current process from the "running" state to the "ready" state,
+        the policy knows it used its whole quantum (e.g. MLFQ demotes it) */
+        expiredProcessHelper(currentProcess);
         currentProcess = NULL;
 
         /*  STEP 5: call the scheduler */
@@ -183,172 +315,283 @@ void PLTInterruptHandler() {
     PANIC();
 }
 
+/*********************************************************************************************
+ * recordWorkHelper
+ * 
+ * @brief
+ * This function records an acknowledged completion on the deferred work queue (there must be room),
+ * and how long it took to acknowledge it (irqAckHelper).
+ * 
+ * @param device_index: the device semaphore index (semaphoreDevices)
+ * @param status: the status of the device before the acknowledge
+ * @return void
+ ***********************************************************************************************/
+HIDDEN void recordWorkHelper(int device_index, unsigned int status) {
+    devwork_t *work = &workQueue[(workHead + workCount) % DEVICE_WORK_SIZE];
+
+    workCount++;
+    work->w_index = device_index;
+    work->w_status = status;
+
+    irqAckHelper(device_index);
+    TRACE(TRACE_INTERRUPT, TRACE_EV_DEVICE, NULL, device_index, status, 0, 0);
+}
+
+/*********************************************************************************************
+ * deviceInterruptHelper
+ * 
+ * @brief
+ * This function is the top half of a device interrupt: it checks the device status, 
+ * acknowledges the interrupt, and records the completion on the deferred work queue.
+ * Everything else (the V, the wake up, the accounting) is left to the bottom half (deviceWorkHelper).
+ * 
+ * @protocol
+ * 0. If the work queue is full, leave the device alone: its interrupt stays pending
+ * 1. Get the Status register of the device
+ *      - if it is the terminal device, check if this is a write or read interrupt
+ *        The t_transm_status in the register is NOT READY doesnt mean the I/O is not ready
+ *        This means this is the write interrupt because
+ *        it is not ready which means that variable in the past was need to update, 
+ *        so it block on it and when the device done, it knock and tell me to take it.
+ *        If the receiver is neither READY nor BUSY, a read completed too: serve both
+ *     - else, we just take the status code
+ * 2. Acknowledge the interrupt (Pandos page 43)
+ * 3. Record the device semaphore and the status on the work queue (recordWorkHelper)
+ * 
+ * @note
+ * Using the cause register of the device that we got the index above, read the status of the device
+ * to understand the outcome of the request
+ * Right now, the device is holding the hammer (interrupt) and knock on the OS head that it is done 
+ * so we need to handle it and tell the I/O that we got the information, please stop annoying us
+ * 
+ * The transmit_status is an 8-bit value that indicates the status of the device
+ * We need to mask it with A8_BITS_ON = 0xFF
+ * 
+ * A terminal with both a write and a read completion pending has both served here,
+ * not one per interrupt: only if the work queue fills up after the write does the read 
+ * keep its interrupt pending.
+ * 
+ * @param interrupt_line_number: the interrupt line (3 to 7)
+ * @param device_num: the device on the line (0 to 7)
+ * @return int: TRUE if the device was acknowledged, FALSE if it was left pending
+ ***********************************************************************************************/
+HIDDEN int deviceInterruptHelper(int interrupt_line_number, int device_num) {
+    /* tells the compiler to interpret the memory starting at RAMBASEADDR as a structure of type devregarea_t */
+    devregarea_t *device_register_area = (devregarea_t *) RAMBASEADDR;
+
+    /* get the device index from the interrupt line number (similar to semaphore index in exception.c)*/
+    int device_index = ((interrupt_line_number - BASE_LINE) * DEVPERINT) + device_num; 
+
+    /* status is the receiver of a terminal, the device itself otherwise */
+    unsigned int transmit_status, status;
+
+    /* Step 0: no room to record it */
+    if (workCount == DEVICE_WORK_SIZE) {
+        return FALSE;
+    }
+
+    /* Step 1 - 3: status, acknowledge, record */
+    if (interrupt_line_number == LINE7) {
+        transmit_status = device_register_area->devreg[device_index].t_transm_status;
+        status = device_register_area->devreg[device_index].t_recv_status;
+
+        if ((transmit_status & A8_BITS_ON) != READY) {
+            device_register_area->devreg[device_index].t_transm_command = ACK;
+            recordWorkHelper(device_index + DEVPERINT, transmit_status);
+
+            /* the receiver has nothing to report, or no room is left for it */
+            if (((status & A8_BITS_ON) == READY) || ((status & A8_BITS_ON) == BUSY) ||
+                (workCount == DEVICE_WORK_SIZE)) {
+                return TRUE;
+            }
+        }
+
+        device_register_area->devreg[device_index].t_recv_command = ACK;
+        recordWorkHelper(device_index, status);
+        return TRUE;
+    }
+
+    status = device_register_area->devreg[device_index].d_status;
+    device_register_area->devreg[device_index].d_command = ACK;
+    recordWorkHelper(device_index, status);
+
+    return TRUE;
+}
+
+/*********************************************************************************************
+ * deviceWorkHelper
+ * 
+ * @brief
+ * This function is the bottom half of the device interrupts: it runs once per interrupt, after
+ * every top half, and processes the recorded completions in the order they were acknowledged.
+ * It runs in the interrupt handler, with the interrupts still off (see the note at the top of the file).
+ * 
+ * @protocol
+ * For each completion on the work queue:
+ * 1. Perform the V operation on the device semaphore, unblocking the process that waits for it.
+ *    If none waits (e.g. a WAITANY woken by another semaphore of its set gave its P back), 
+ *    keep the status for the next P on the semaphore (devicePendingStatus)
+ * 2. Save the status code to register v0 of the unblocked process 
+ *    (v1 for a WAITANY, claimWaiterHelper), decrease the soft block count,
+ *    and stamp it with the interrupt for its dispatch latency (irqDispatchHelper)
+ * 3. Charge the unblocked process the time spent on its completion, and make it ready
+ * 
+ * @param served_TOD: the time the top halves were done
+ * @return int: TRUE if one of the unblocked processes should preempt the current one
+ ***********************************************************************************************/
+HIDDEN int deviceWorkHelper(cpu_t served_TOD) {
+    devwork_t *work;
+    pcb_PTR pcb_to_unblock;
+    int preempt = FALSE;
+
+    while (workCount > 0) {
+        work = &workQueue[workHead];
+        workHead = (workHead + 1) % DEVICE_WORK_SIZE;
+        workCount--;
+
+        /* Step 1: perform the V operation */
+        pcb_to_unblock = removeBlocked(&semaphoreDevices[work->w_index]);
+        semaphoreDevices[work->w_index]++;
+        if (pcb_to_unblock == NULL) {
+            devicePendingStatus[work->w_index] = work->w_status;
+            continue;
+        }
+
+        /* Step 2: the status goes to the unblocked process */
+        if (pcb_to_unblock->p_waitOwner != NULL) {
+            /* A WAITANY: v0 is the index of the semaphore in its set, v1 the status */
+            pcb_to_unblock = claimWaiterHelper(pcb_to_unblock);
+            pcb_to_unblock->p_s.s_v1 = work->w_status;
+        } else {
+            pcb_to_unblock->p_s.s_v0 = work->w_status;
+        }
+        softBlockedCount--;
+        pcb_to_unblock->p_irqIndex = work->w_index;
+        pcb_to_unblock->p_irqTOD = interrupt_TOD;
+        TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, pcb_to_unblock, work->w_status, 0, 0, 0);
+
+        /* Step 3: charge it and make it ready */
+        STCK(curr_TOD);
+        updateProcessTimeHelper(pcb_to_unblock, served_TOD, curr_TOD);
+        served_TOD = curr_TOD;
+
+        insertReadyQueueHelper(pcb_to_unblock);
+        if (currentProcess != NULL && preemptsCurrentHelper(pcb_to_unblock)) {
+            preempt = TRUE;
+        }
+    }
+
+    return preempt;
+}
+
 /*********************************************************************************************
  * nonTimerInterruptHandler
  * 
  * @brief
  * This function is used to handle non-timer interrupts.
- * The function first calculates the device register address,
- * then checks the device status, acknowledges the interrupt, and performs the V operation.
- * Finally, it saves the status code to the newly unblocked process register v0 and inserts the PCB to the ready queue.
+ * It serves every device with an interrupt pending, on every line pending in the Cause register, 
+ * in a single kernel entry: a burst of disk and terminal completions costs one exception, 
+ * not one per device.
  * 
  * @protocol
- * 7 Step is descriped in the function
+ * 1. Charge the current process its CPU time up to the interrupt
+ * 2. Top halves: for each device line (3 to 7) pending in the Cause register, and each device pending 
+ *    in the line's bit map, round-robin (see nextBitHelper), at most lineWeight devices per line
+ *    (at least one, a pending line that is never acknowledged would raise the same interrupt forever),
+ *    acknowledge it and record its completion (deviceInterruptHelper)
+ * 3. Bottom half: V the device semaphores and make the unblocked processes ready (deviceWorkHelper).
+ *    With SCHED_WAKEUP_PREEMPT, if the policy prefers one of them to the current one, 
+ *    the current one yields (its state is saved first) and the scheduler is called
+ * 4. Otherwise return control to the current process, or call the scheduler
+ * 
+ * @note
+ * The bit maps are read once per line, a device that completes while they are served 
+ * raises a new interrupt, as does a device left over by the weight of its line.
+ * With every device of a line busy, a device waits at most DEVPERINT / lineWeight interrupts.
+ * 
+ * Every device is acknowledged (and may start its next operation) before any process is woken,
+ * and the wake ups of all the completions are batched in one pass.
+ * 
+ * TIME POLICY:
+ * Each unblocked process is charged the time of its own bottom half, 
+ * the current process is charged up to the interrupt.
  * 
  * @param void
  * @return void
  ***********************************************************************************************/
 void nonTimerInterruptHandler() {
     /* tells the compiler to interpret the memory starting at RAMBASEADDR as a structure of type devregarea_t */
-    devregarea_t *device_register_area;
-    device_register_area = (devregarea_t *) RAMBASEADDR;
+    devregarea_t *device_register_area = (devregarea_t *) RAMBASEADDR;
 
+    int line_index, device_num, budget;
+    int first_line = -1;
+    unsigned int interrupt_lines, device_bit_map;
 
-    /**
-     * STEP 1: Calculate the Device Register Address
-     * 
-     * @brief
-     * What It Means:
-     * Every I/O device has a specific location in memory called its device register.
-     * This register is used to both read information (the status when the I/O return you smth it done)
-     * and send commands (you use this to tell I/O that you got the information, please don't annoy).
-     * 
-     * @note
-     * 1. The handler calculates the memory address based on the device’s known location in the system
-     * Like a “mailbox” in memory holds the device’s information. 
-     * 
-     * 2. Get the interrupt line number from the Cause register
-     * (Pandos page 18) IP (bits 8-15): an 8-bit field indicating on which interrupt lines interrupts
-     * are currently pending. If an interrupt is pending on interrupt 
-     * line i, then Cause.IP[i] is set to 1.
-     *
-     * 3. Mask the Cause register with the interrupt line number to get the interrupt line number
-     * 
-     * 4. Find the device index in the device register area
-     *      - Convert to base 0 index
-     *      - Multiply number of devices per interrupt line.
-     *      - Add the device number  
-     * 
-     * @protocol
-     * 1. Mask the Cause register with the interrupt line number to get the interrupt line number
-     * 2. Find the device number
-     * 3. Find the device index in the device register area
-     */
-
-    /* get the interrupt line number by masking (Step 3) */
-    int interrupt_line_number;
-	if (((savedExceptionState->s_cause) & 0x00000800) != ALLOFF){ 
-		interrupt_line_number = LINE3;
-	} else if (((savedExceptionState->s_cause) & 0x00001000) != ALLOFF){
-		interrupt_line_number = LINE4; 
-	} else if (((savedExceptionState->s_cause) & 0x00002000) != ALLOFF){ 
-		interrupt_line_number = LINE5;
-	} else if (((savedExceptionState->s_cause) & 0x00004000) != ALLOFF){ 
-		interrupt_line_number = LINE6;
-	} else { 
-		interrupt_line_number = LINE7; 
-	}
-
-    /* get the device number */
-    int device_num = findInterruptDevice(interrupt_line_number);
-
-    /* get the device index from the interrupt line number (similar to semaphore index in exception.c)*/
-    int device_index = ((interrupt_line_number - BASE_LINE) * DEVPERINT) + device_num; 
-
+    /* Step 1: charge the current process up to the interrupt */
+    if (currentProcess != NULL) {
+        updateProcessTimeHelper(currentProcess, start_TOD, interrupt_TOD);
+    }
 
     /**
-     * STEP 2 + 3 + 4: Check the Device Status, Acknowledge the Interrupt, Perfom the V Operation
-     * 
-     * Using the cause register of the device that we got the index above, read the status of the device
-     * to understand the outcome of the request
-     * Right now, the device is holding the hammer (interrupt) and knock on the OS head that it is done 
-     * so we need to handle it and tell the I/O that we got the information, please stop annoying us
-     * This is done by writing to the device register area acknowledge the interrupt and perform the V operation
-     * This means the process that is waiting for the device to finish can continue
-     * 
-     * @protocol
-     * 1. get the Status register of the device
-     *      - if it is the terminal device, check if this is a write or read interrupt
-     *        The t_transm_status in the register is NOT READY doesnt mean the I/O is not ready
-     *        This means this is the write interrupt because
-     *        it is not ready which means that variable in the past was need to update, 
-     *        so it block on it and when the device done, it knock and tell me to take it
-     *     - else, we just take the status code
-     * 2. Acknowledge the interrupt (Pandos page 43)
-     * 3. Perform the V operation
-     *      - Unblock the process that is waiting for the device to finish
-     *      - The process that is waiting for the device to finish can continue
-     *      - Increase semaphore value by 1
+     * STEP 2: Serve every pending device
      * 
      * @note
-     * The transmit_status is an 8-bit value that indicates the status of the device
-     * We need to mask it with A8_BITS_ON = 0xFF
+     * (Pandos page 18) IP (bits 8-15): an 8-bit field indicating on which interrupt lines interrupts
+     * are currently pending. If an interrupt is pending on interrupt line i, then Cause.IP[i] is set to 1.
+     * The line's bit map in the Interrupting Devices Bit Map area has bit d set if device d is pending.
+     * Both are decoded through lowestBitTable in round-robin order (nextBitHelper): the lines from 
+     * nextLine, the devices of a line from nextDevice, so disk 0 or terminal 0 cannot starve the others.
      */
+    interrupt_lines = ((savedExceptionState->s_cause >> CAUSE_INT_SHIFT) & DEVICE_LINES_MASK) >> BASE_LINE;
+    while (interrupt_lines != ALLOFF) {
+        line_index = nextBitHelper(interrupt_lines, nextLine, DEVINTNUM);
+        interrupt_lines &= ~(1 << line_index);
+        if (first_line < 0) {
+            first_line = line_index;
+        }
+
+        device_bit_map = device_register_area->interrupt_dev[line_index] & A8_BITS_ON;
+        budget = (lineWeight[line_index] > 0) ? lineWeight[line_index] : 1;
+        while (device_bit_map != ALLOFF && budget > 0) {
+            device_num = nextBitHelper(device_bit_map, nextDevice[line_index], DEVPERINT);
+            device_bit_map &= ~(1 << device_num);
+            if (!deviceInterruptHelper(line_index + BASE_LINE, device_num)) {
+                break;
+            }
+            budget--;
+
+            /* the next scan of this line starts after it */
+            nextDevice[line_index] = (device_num + 1) % DEVPERINT;
+        }
+    }
 
-    int status_code;
-    pcb_PTR pcb_to_unblock;
-    if (
-        (interrupt_line_number == LINE7) && 
-        (((device_register_area->devreg[device_index].t_transm_status) & A8_BITS_ON) != READY)){
-		    
-            /* save the status code */
-            status_code = device_register_area->devreg[device_index].t_transm_status;
-
-            /* acknowledge the interrupt */
-		    device_register_area->devreg[device_index].t_transm_command = ACK;
-
-            /* perform the V operation */
-            pcb_to_unblock = removeBlocked(&semaphoreDevices[device_index + DEVPERINT]);
-		    semaphoreDevices[device_index + DEVPERINT]++;
-	} else {
-		status_code = device_register_area->devreg[device_index].t_recv_status;
-		device_register_area->devreg[device_index].t_recv_command = ACK;
-		pcb_to_unblock = removeBlocked(&semaphoreDevices[device_index]);
-		semaphoreDevices[device_index]++;
-	}
+    /* the next drain starts after the line that went first */
+    if (first_line >= 0) {
+        nextLine = (first_line + 1) % DEVINTNUM;
+    }
 
-    /**
-     * STEP 5 + 6: Save the status code to newly unblock process register v0 and insert the PCB to the ready queue
-     * 
-     * @brief
-     * Save the status to register 0 of the PCB that is unblocked
-     * Kick in the @$$ of the PCB to the ready queue because now the I/O is done
-     * 
-     * @protocol
-     * 1. Save the status code to register v0
-     * 2. Insert the PCB to the ready queue
-     * 
-     * TIME POLICY:
-     * The pvb to unblock get charge the process time and then OS will return to 
-     * current process
-    */
-    if (pcb_to_unblock != NULL) {
-        pcb_to_unblock->p_s.s_v0 = status_code;
-        insertProcQ(&readyQueue, pcb_to_unblock);
-        softBlockedCount--;
-        STCK(curr_TOD);
-/*         pcb_to_unblock->p_time = pcb_to_unblock->p_time + (curr_TOD - interrupt_TOD); */
-        updateProcessTimeHelper(pcb_to_unblock, interrupt_TOD, curr_TOD);
+    /* Step 3: the bottom halves, then an unblocked process may take the CPU */
+    STCK(curr_TOD);
+    if (deviceWorkHelper(curr_TOD)) {
+        addPigeonCurrentProcessHelper();
+        yieldProcessHelper(currentProcess);
+        currentProcess = NULL;
+        scheduler();
     }
 
-    /** STEP 7: Switch Control to the current process
+    /** STEP 4: Switch Control to the current process
      * 
      * @brief
      * The handler performs an LDST (Load State) operation, which restores the saved exception state from the BIOS Data Page. 
      * This step effectively transfers control back to the process that was interrupted, now with the I/O completion handled.
      * 
      * @protocol
-     * 1. add the exception state to the current process
-     * 2. Set the timer to the current process time left
-     * 3. Set the current process time to the current process time + (current time - interrupt time)
-     * 4. Switch control to the current process
+     * 1. Set the timer to the current process time left
+     * 2. Resume the current process straight from the BIOS Data Page (its time was charged in step 1)
     */
     if (currentProcess != NULL) {
-        addPigeonCurrentProcessHelper();
         setTIMER(current_process_time_left);
-        STCK(curr_TOD);
-        updateProcessTimeHelper(currentProcess, start_TOD, interrupt_TOD);
-        switchContext(currentProcess);
+        resumeContext();
     }
 
     scheduler();
@@ -368,28 +611,57 @@ void nonTimerInterruptHandler() {
  * 
  * @protocol
  * 1. Acknowledge the interrupt by loading the Interval Timer with 100 milliseconds.
- * 2. Unblock all PCBs blocked on the Pseudo-clock semaphore
+ * 2. Unblock all PCBs blocked on the Pseudo-clock semaphore (wakeAllBlockedHelper: in one splice,
+ *    straight onto the ready queue when the policy allows it, a WAITANY among them is woken
+ *    through claimAllWaitersHelper), stamped for their dispatch
+ *    latency in the same walk, wake the trace drain (traceDrainTickHelper),
+ *    and tell the scheduling policy the pseudo-clock ticked
+ * 2.7 Expire the timed P (TIMEDP) whose deadline has passed: only the head of the timeout list 
+ *    is looked at, since it is sorted by deadline. Each one leaves its semaphore (giving back the 
+ *    unit its P took), gets ERROR_CONST in v0 and is made ready.
  * 3. Reset the Pseudo-clock semaphore to zero.
- * 4. Return control to the Current Process if one exists, otherwise call scheduler.
+ * 4. Return control to the Current Process if one exists (straight from the BIOS Data Page),
+ *    otherwise call scheduler.
  * 
  * @note
  * Unblocked processes join the ready queue in a round-robin manner
  * it just makes them eligible to be scheduled again.
  * 
+ * @note
+ * A deadline is checked once per pseudo-clock tick, so a timed P may wait up to 
+ * INTERVAL_TIMER past its deadline.
+ * 
  * @param void
  * @return void
  ***********************************************************************************************/
 void intervalTimerInterruptHandler() {
-    pcb_PTR pcb_to_unblock;
+    int woken_count;
+    pcb_PTR expired_pcb;
+    int *expired_semaphore;
 
     /* Step 1: Acknowledge the interrupt by loading the Interval Timer with 100 milliseconds. */
     LDIT(INTERVAL_TIMER);
-
-    /* Step 2: Unblock ALL pcbs blocked on the Pseudo-clock semaphore */
-    while (headBlocked(&semaphoreDevices[CLOCK_INDEX]) != NULL) {
-        pcb_to_unblock = removeBlocked(&semaphoreDevices[CLOCK_INDEX]);
-        insertProcQ(&readyQueue, pcb_to_unblock);
-        softBlockedCount--;
+    irqAckHelper(CLOCK_INDEX);
+
+    /* Step 2: Unblock ALL pcbs blocked on the Pseudo-clock semaphore, the whole queue
+    is taken off the ASL at once, stamped for their dispatch latency on the way, and made ready */
+    woken_count = wakeAllBlockedHelper(&semaphoreDevices[CLOCK_INDEX], TRUE, CLOCK_INDEX, interrupt_TOD);
+    softBlockedCount -= woken_count;
+    traceDrainTickHelper();
+
+    /* Step 2.5: Tell the policy the pseudo-clock ticked (e.g. the MLFQ priority boost) */
+    clockTickHelper();
+
+    /* Step 2.7: Expire the timed P whose deadline has passed, earliest first */
+    expired_pcb = headTimeout();
+    while (expired_pcb != NULL && expired_pcb->p_deadline - interrupt_TOD <= 0) {
+        expired_semaphore = expired_pcb->p_semAdd;
+        outBlocked(expired_pcb);
+        (*expired_semaphore)++;
+        expired_pcb->p_s.s_v0 = ERROR_CONST;
+        TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, expired_pcb, ERROR_CONST, 0, 0, 0);
+        insertReadyQueueHelper(expired_pcb);
+        expired_pcb = headTimeout();
     }
 
     /* Step 3: Reset the Pseudo-clock semaphore to zero. */
@@ -398,9 +670,8 @@ void intervalTimerInterruptHandler() {
     /* Step 4: Return control to the Current Process if one exists, otherwise call scheduler. */
     if (currentProcess != NULL) {
         setTIMER(current_process_time_left);
-        addPigeonCurrentProcessHelper();
         updateProcessTimeHelper(currentProcess, start_TOD, interrupt_TOD);
-        switchContext(currentProcess);
+        resumeContext();
     }
     
     /* Step 5: Call the scheduler */
@@ -460,6 +731,9 @@ void interruptTrapHandler() {
     /* extract the pending interrupt bits (bits 8-15 of the Cause register) */
     int interrupt_bit = savedExceptionState->s_cause;
 
+    TRACE(TRACE_INTERRUPT, TRACE_EV_INTERRUPT, currentProcess, 
+          (interrupt_bit >> CAUSE_INT_SHIFT) & A8_BITS_ON, current_process_time_left, savedExceptionState->s_pc, 0);
+
 
     /**
      * @note
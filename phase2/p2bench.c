@@ -0,0 +1,221 @@
+/*********************************P2BENCH.C*******************************
+ *
+ *	Microbenchmarks for the nucleus: phase 2.
+ *
+ *	Linked in place of p2test (make TEST=p2bench), produces its results
+ *	on Terminal0.
+ *
+ *	Each benchmark times a batch of calls (BENCHRUNS, or DECODERUNS passes over
+ *	the bit maps) with the interrupts off, reading the TOD clock before and after. The TOD counts processor cycles (STCK would
+ *	divide them by the time scale into microseconds), so every result is the
+ *	cycles taken by one call, less those of an empty call through the same loop.
+ *
+ *		- moveStateHelper, against the field by field copy it replaced
+ *		- findInterruptDevice (lowestBitTable), against the eight bit tests it replaced,
+ *		  over every non-empty device bit map
+ *		- a GETCPUTIME syscall, the shortest way in and out of the nucleus
+ */
+
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/scheduler.h"
+#include "../h/interrupts.h"
+#include "/usr/include/umps3/umps/libumps.h"
+
+typedef unsigned int devregtr;
+
+#define TERMSTATMASK	0xFF
+#define	TERM0ADDR		0x10000254
+
+#define BENCHRUNS		1000	/* calls timed by each benchmark */
+#define DECODERUNS		4		/* passes over the 255 bit maps of a decode benchmark */
+#define BITMAPS			256		/* the 8-bit device bit maps, 0 (empty) is skipped */
+#define NUMLEN			11		/* digits of the largest unsigned int, and the EOS */
+
+
+int term_mut = 1;					/* for mutual exclusion on terminal */
+
+state_t benchSource, benchDestination;	/* the states the copies move */
+
+
+/* a procedure to print on terminal 0 */
+void print(char *msg) {
+
+	char *s = msg;
+	devregtr * base = (devregtr *) (TERM0ADDR);
+	devregtr status;
+
+	SYSCALL(SYS3_NUM, (int)&term_mut, 0, 0);				/* P(term_mut) */
+	while (*s != EOS) {
+		*(base + 3) = PRINTCHR | (((devregtr) *s) << CHAR_SHIFT);
+		status = SYSCALL(SYS5_NUM, TERMINT, 0, 0);
+		if ((status & TERMSTATMASK) != CHAR_TRANSMITTED)
+			PANIC();
+		s++;
+	}
+	SYSCALL(SYS4_NUM, (int)&term_mut, 0, 0);				/* V(term_mut) */
+}
+
+
+/* print a number in decimal */
+void printNum(unsigned int number) {
+
+	char digits[NUMLEN];
+	int i = NUMLEN - 1;
+
+	digits[i] = EOS;
+	do {
+		digits[--i] = '0' + (number % 10);
+		number /= 10;
+	} while (number != 0);
+	print(&digits[i]);
+}
+
+
+/* print one result line: the cycles of a call, less the empty call */
+void report(char *name, unsigned int cycles, unsigned int overhead) {
+
+	print(name);
+	printNum((cycles > overhead) ? (cycles - overhead) : 0);
+	print(" cycles\n");
+}
+
+
+/* TLB-Refill Handler */
+/* One can place debug calls here, but not calls to print */
+void uTLB_RefillHandler () {
+
+	setENTRYHI(0x80000000);
+	setENTRYLO(0x00000000);
+	TLBWR();
+
+	LDST ((state_PTR) 0x0FFFF000);
+}
+
+
+/* the empty call, timed to take the loop and the call out of the others */
+void emptyCopy(state_PTR source_state, state_PTR destination_state) {
+}
+
+
+/* the copy moveStateHelper replaced: the four fields, then the registers one by one */
+void fieldCopy(state_PTR source_state, state_PTR destination_state) {
+
+	int i;
+
+	destination_state->s_entryHI = source_state->s_entryHI;
+	destination_state->s_cause = source_state->s_cause;
+	destination_state->s_status = source_state->s_status;
+	destination_state->s_pc = source_state->s_pc;
+	for (i = 0; i < STATEREGNUM; i++) {
+		destination_state->s_reg[i] = source_state->s_reg[i];
+	}
+}
+
+
+/* cycles taken by one call of copy, averaged over BENCHRUNS calls */
+unsigned int copyCycles(void (*copy)(state_PTR, state_PTR)) {
+
+	unsigned int status = getSTATUS();
+	unsigned int start, end;
+	int i;
+
+	setSTATUS(status & ~IECON);
+	start = *((unsigned int *) TODLOADDR);
+	for (i = 0; i < BENCHRUNS; i++) {
+		copy(&benchSource, &benchDestination);
+	}
+	end = *((unsigned int *) TODLOADDR);
+	setSTATUS(status);
+
+	return (end - start) / BENCHRUNS;
+}
+
+
+/* the empty decode, timed to take the loop and the call out of the others */
+int emptyDecode(unsigned int device_bit_map) {
+	return 0;
+}
+
+
+/* the decode findInterruptDevice replaced: the device bits one by one */
+int bitTestDecode(unsigned int device_bit_map) {
+
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_0) != ALLOFF)
+		return DEVICE_0;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_1) != ALLOFF)
+		return DEVICE_1;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_2) != ALLOFF)
+		return DEVICE_2;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_3) != ALLOFF)
+		return DEVICE_3;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_4) != ALLOFF)
+		return DEVICE_4;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_5) != ALLOFF)
+		return DEVICE_5;
+	if ((device_bit_map & INTERRUPTS_BIT_CONST_DEVICE_6) != ALLOFF)
+		return DEVICE_6;
+	return DEVICE_7;
+}
+
+
+/* cycles taken by one decode, averaged over DECODERUNS passes over every non-empty bit map */
+unsigned int decodeCycles(int (*decode)(unsigned int)) {
+
+	unsigned int status = getSTATUS();
+	unsigned int start, end, bit_map;
+	int i;
+
+	setSTATUS(status & ~IECON);
+	start = *((unsigned int *) TODLOADDR);
+	for (i = 0; i < DECODERUNS; i++) {
+		for (bit_map = 1; bit_map < BITMAPS; bit_map++) {
+			decode(bit_map);
+		}
+	}
+	end = *((unsigned int *) TODLOADDR);
+	setSTATUS(status);
+
+	return (end - start) / (DECODERUNS * (BITMAPS - 1));
+}
+
+
+/* cycles taken by one GETCPUTIME syscall, averaged over BENCHRUNS calls */
+unsigned int syscallCycles() {
+
+	unsigned int status = getSTATUS();
+	unsigned int start, end;
+	int i;
+
+	setSTATUS(status & ~IECON);
+	start = *((unsigned int *) TODLOADDR);
+	for (i = 0; i < BENCHRUNS; i++) {
+		SYSCALL(SYS6_NUM, 0, 0, 0);
+	}
+	end = *((unsigned int *) TODLOADDR);
+	setSTATUS(status);
+
+	return (end - start) / BENCHRUNS;
+}
+
+
+void test() {
+
+	unsigned int overhead;
+
+	print("p2bench: cycles per call\n");
+
+	overhead = copyCycles(emptyCopy);
+	report("moveStateHelper     ", copyCycles(moveStateHelper), overhead);
+	report("field by field copy ", copyCycles(fieldCopy), overhead);
+
+	overhead = decodeCycles(emptyDecode);
+	report("findInterruptDevice ", decodeCycles(findInterruptDevice), overhead);
+	report("bit by bit decode   ", decodeCycles(bitTestDecode), overhead);
+
+	report("GETCPUTIME syscall  ", syscallCycles(), 0);
+
+	print("p2bench: done\n");
+
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
@@ -0,0 +1,362 @@
+/*********************************P2EXT.C*******************************
+ *
+ *	Test program for the nucleus extensions: phase 2.
+ *
+ *	Linked in place of p2test (make TEST=p2ext), produces progress messages
+ *	on Terminal0.
+ *
+ *	Runs each extension syscall through its success, blocking and error paths:
+ *	TRYP, SIGNALWAIT, MULTICALL, TIMEDP, WAITANY, VN, BROADCAST, IRQSTATS and
+ *	TRACECTL, and an extension number out of range. WAITANY and SYS5 are also
+ *	given a terminal completion that arrives while the caller is not waiting
+ *	for it, which the next call must still return.
+ *
+ *		Aborts as soon as an error is detected.
+ */
+
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/initial.h"
+#include "../h/trace.h"
+#include "/usr/include/umps3/umps/libumps.h"
+
+typedef unsigned int devregtr;
+
+/* hardware constants */
+#define TERMSTATMASK	0xFF
+#define	TERM0ADDR		0x10000254
+
+#define QPAGE			1024
+
+#define IEPBITON		0x4
+#define CAUSEINTMASK	0xFD00
+#define TEBITON			0x08000000
+
+#define BADADDR			0xFFFFFFFF
+#define CREATENOGOOD	-1
+
+#define TIMEOUT			200000		/* a TIMEDP that expires: two pseudo-clock ticks, in microseconds */
+#define LONGTIMEOUT		2000000		/* a TIMEDP that a V ends first */
+#define FANOUT			3			/* waiters of the VN and BROADCAST test */
+#define BADOP			99			/* not a MULTICALL operation */
+
+/* the semaphore of the terminal 0 transmitter */
+#define TERM0WRITESEM	(&semaphoreDevices[((TERMINT - BASE_LINE) * DEVPERINT) + DEVPERINT])
+
+/* just to be clear */
+#define SEMAPHORE		int
+
+
+SEMAPHORE term_mut=1,	/* for mutual exclusion on terminal */
+		ping=0,			/* SIGNALWAIT: V'd by the test, P'd by pingChild */
+		pong=0,			/* SIGNALWAIT: V'd by pingChild, P'd by the test */
+		childGo=0,		/* MULTICALL: starts mcChild */
+		mcSem=0,		/* MULTICALL: V'd by mcChild */
+		timedSem=0,		/* TIMEDP: V'd by timedChild */
+		anySem[2],		/* WAITANY: the set */
+		childReady=0,	/* VN: each fanChild is blocked on fanSem */
+		fanSem=0,		/* VN and BROADCAST: the fanChild wait on it */
+		endChild=0;		/* a fanChild is done */
+
+int		pinged = FALSE;	/* pingChild ran */
+int		survived = FALSE;	/* badChild came back from a bad syscall */
+
+state_t childState;		/* the state of the next child */
+memaddr nextStack;		/* and its stack */
+
+irqstats_t stats;		/* IRQSTATS copy */
+
+void	pingChild(), mcChild(), timedChild(), anyChild(), devChild(), fanChild(), badChild();
+
+
+/* a procedure to print on terminal 0 */
+void print(char *msg) {
+
+	char *s = msg;
+	devregtr * base = (devregtr *) (TERM0ADDR);
+	devregtr status;
+
+	SYSCALL(SYS3_NUM, (int)&term_mut, 0, 0);				/* P(term_mut) */
+	while (*s != EOS) {
+		*(base + 3) = PRINTCHR | (((devregtr) *s) << CHAR_SHIFT);
+		status = SYSCALL(SYS5_NUM, TERMINT, 0, 0);
+		if ((status & TERMSTATMASK) != CHAR_TRANSMITTED)
+			PANIC();
+		s++;
+	}
+	SYSCALL(SYS4_NUM, (int)&term_mut, 0, 0);				/* V(term_mut) */
+}
+
+
+/* abort with a message unless ok */
+void check(int ok, char *msg) {
+
+	if (!ok) {
+		print("error: ");
+		print(msg);
+		print("\n");
+		PANIC();
+	}
+}
+
+
+/* start a child at code, on a stack of its own */
+void create(void (*code)()) {
+
+	STST(&childState);
+	childState.s_sp = nextStack;
+	nextStack -= QPAGE;
+	childState.s_pc = childState.s_t9 = (memaddr) code;
+	childState.s_status = childState.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+
+	check((int) SYSCALL(SYS1_NUM, (int)&childState, (int) NULL, 0) != CREATENOGOOD, "child not created");
+}
+
+
+/* TLB-Refill Handler */
+/* One can place debug calls here, but not calls to print */
+void uTLB_RefillHandler () {
+
+	setENTRYHI(0x80000000);
+	setENTRYLO(0x00000000);
+	TLBWR();
+
+	LDST ((state_PTR) 0x0FFFF000);
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*                 test -- the root process                          */
+/*                                                                   */
+void test() {
+	int		a, b, r;
+	unsigned int n, mask, status;
+	cpu_t	now, later;
+	sysop_t	ops[3];
+	int		*set[WAITANY_MAX + 1];
+	int		i, dev_index, dev_again;
+	devregtr *base = (devregtr *) (TERM0ADDR);
+
+	STST(&childState);
+	nextStack = childState.s_sp - QPAGE;
+
+	print("p2ext starts\n");
+
+	/* TRYP: a free semaphore is passed, a busy one is left alone */
+	a = 1;
+	check((int) SYSCALL(TRYP_NUM, (int)&a, 0, 0) == SUCCESS_CONST && a == 0, "TRYP on a free semaphore");
+	check((int) SYSCALL(TRYP_NUM, (int)&a, 0, 0) == ERROR_CONST && a == 0, "TRYP on a busy semaphore");
+	print("TRYP ok\n");
+
+	/* SIGNALWAIT: no block, the same semaphore twice, then a ping-pong that blocks */
+	a = 0;
+	b = 1;
+	SYSCALL(SIGNALWAIT_NUM, (int)&a, (int)&b, 0);
+	check(a == 1 && b == 0, "SIGNALWAIT without a block");
+	a = 0;
+	SYSCALL(SIGNALWAIT_NUM, (int)&a, (int)&a, 0);
+	check(a == 0, "SIGNALWAIT on a single semaphore");
+	create(pingChild);
+	SYSCALL(SIGNALWAIT_NUM, (int)&ping, (int)&pong, 0);
+	check(pinged && ping == 0 && pong == 0, "SIGNALWAIT ping-pong");
+	print("SIGNALWAIT ok\n");
+
+	/* MULTICALL: a whole batch, a batch cut by an unknown operation, a batch that blocks */
+	a = 0;
+	ops[0].op_code = SYS4_NUM;	ops[0].op_arg = (int)&a;
+	ops[1].op_code = SYS3_NUM;	ops[1].op_arg = (int)&a;
+	ops[2].op_code = SYS6_NUM;	ops[2].op_arg = 0;
+	r = SYSCALL(MULTICALL_NUM, (int)ops, 3, 0);
+	check(r == 3 && a == 0 && ops[0].op_result == SUCCESS_CONST && ops[1].op_result == SUCCESS_CONST &&
+		ops[2].op_result > 0, "MULTICALL batch");
+	ops[1].op_code = BADOP;
+	ops[2].op_code = SYS4_NUM;	ops[2].op_arg = (int)&a;
+	r = SYSCALL(MULTICALL_NUM, (int)ops, 3, 0);
+	check(r == 1 && a == 1 && ops[1].op_result == ERROR_CONST, "MULTICALL unknown operation");
+	create(mcChild);
+	b = 0;
+	ops[0].op_code = SYS4_NUM;	ops[0].op_arg = (int)&childGo;
+	ops[1].op_code = SYS3_NUM;	ops[1].op_arg = (int)&mcSem;
+	ops[2].op_code = SYS4_NUM;	ops[2].op_arg = (int)&b;
+	r = SYSCALL(MULTICALL_NUM, (int)ops, 3, 0);
+	check(r == 2 && mcSem == 0 && b == 0, "MULTICALL batch stopped by a P");
+	print("MULTICALL ok\n");
+
+	/* TIMEDP: free, deadline already gone, device semaphore, expired, ended by a V */
+	a = 1;
+	STCK(now);
+	check((int) SYSCALL(TIMEDP_NUM, (int)&a, now + LONGTIMEOUT, 0) == SUCCESS_CONST && a == 0,
+		"TIMEDP on a free semaphore");
+	STCK(now);
+	check((int) SYSCALL(TIMEDP_NUM, (int)&a, now, 0) == ERROR_CONST && a == 0, "TIMEDP past its deadline");
+	check((int) SYSCALL(TIMEDP_NUM, (int)TERM0WRITESEM, now + LONGTIMEOUT, 0) == ERROR_CONST,
+		"TIMEDP on a device semaphore");
+	STCK(now);
+	r = SYSCALL(TIMEDP_NUM, (int)&a, now + TIMEOUT, 0);
+	STCK(later);
+	check(r == ERROR_CONST && a == 0 && later - now >= TIMEOUT, "TIMEDP expired");
+	create(timedChild);
+	STCK(now);
+	check((int) SYSCALL(TIMEDP_NUM, (int)&timedSem, now + LONGTIMEOUT, 0) == SUCCESS_CONST && timedSem == 0,
+		"TIMEDP ended by a V");
+	print("TIMEDP ok\n");
+
+	/* WAITANY: bad sets, a free semaphore, a wait woken by the second semaphore */
+	set[0] = &anySem[0];
+	set[1] = &anySem[1];
+	check((int) SYSCALL(WAITANY_NUM, (int)set, 0, 0) == ERROR_CONST, "WAITANY on an empty set");
+	for (i = 0; i <= WAITANY_MAX; i++) {
+		set[i] = &anySem[i % 2];
+	}
+	check((int) SYSCALL(WAITANY_NUM, (int)set, WAITANY_MAX + 1, 0) == ERROR_CONST, "WAITANY on a set too large");
+	check((int) SYSCALL(WAITANY_NUM, (int)set, 3, 0) == ERROR_CONST, "WAITANY on a semaphore twice");
+	anySem[0] = 0;
+	anySem[1] = 1;
+	check((int) SYSCALL(WAITANY_NUM, (int)set, 2, 0) == 1 && anySem[0] == 0 && anySem[1] == 0,
+		"WAITANY with a free semaphore");
+	create(anyChild);
+	check((int) SYSCALL(WAITANY_NUM, (int)set, 2, 0) == 1 && anySem[0] == 0 && anySem[1] == 0,
+		"WAITANY woken by a V");
+
+	/* WAITANY on the terminal: woken by anySem[0] while devChild starts a write, the completion
+	   comes when nobody waits, and the next WAITANY must return it at once (the test owns
+	   the terminal meanwhile, so nothing is printed until it is checked). SYSCALL only returns v0,
+	   the status WAITANY places in v1 is checked through SYS5 below */
+	SYSCALL(SYS3_NUM, (int)&term_mut, 0, 0);				/* P(term_mut) */
+	set[1] = TERM0WRITESEM;
+	create(devChild);
+	dev_index = SYSCALL(WAITANY_NUM, (int)set, 2, 0);
+	SYSCALL(SYS7_NUM, 0, 0, 0);								/* the write is done by now */
+	dev_again = SYSCALL(WAITANY_NUM, (int)set, 2, 0);
+
+	/* and SYS5: a write that completes before the wait */
+	*(base + 3) = PRINTCHR | (((devregtr) '.') << CHAR_SHIFT);
+	SYSCALL(SYS7_NUM, 0, 0, 0);
+	status = SYSCALL(SYS5_NUM, TERMINT, 0, 0);
+	SYSCALL(SYS4_NUM, (int)&term_mut, 0, 0);				/* V(term_mut) */
+	print("\n");
+
+	check(dev_index == 0, "WAITANY on a device and a semaphore");
+	check(dev_again == 1 && *TERM0WRITESEM == 0, "WAITANY lost a completion nobody waited for");
+	check((status & TERMSTATMASK) == CHAR_TRANSMITTED, "SYS5 lost a completion nobody waited for");
+	print("WAITANY ok\n");
+
+	/* VN and BROADCAST: no waiters, bad count, then FANOUT waiters released in two calls */
+	a = 0;
+	check((int) SYSCALL(VN_NUM, (int)&a, 0, 0) == ERROR_CONST && a == 0, "VN of 0");
+	check((int) SYSCALL(VN_NUM, (int)&a, 3, 0) == 0 && a == 3, "VN without waiters");
+	check((int) SYSCALL(BROADCAST_NUM, (int)&a, 0, 0) == 0 && a == 3, "BROADCAST on a free semaphore");
+	a = 0;
+	check((int) SYSCALL(BROADCAST_NUM, (int)&a, 0, 0) == 0 && a == 0, "BROADCAST without waiters");
+	for (i = 0; i < FANOUT; i++) {
+		create(fanChild);
+	}
+	for (i = 0; i < FANOUT; i++) {
+		SYSCALL(SYS3_NUM, (int)&childReady, 0, 0);
+	}
+	check(fanSem == -FANOUT, "fanChild not blocked");
+	check((int) SYSCALL(VN_NUM, (int)&fanSem, FANOUT - 1, 0) == FANOUT - 1 && fanSem == -1, "VN with waiters");
+	check((int) SYSCALL(BROADCAST_NUM, (int)&fanSem, 0, 0) == 1 && fanSem == 0, "BROADCAST with a waiter");
+	for (i = 0; i < FANOUT; i++) {
+		SYSCALL(SYS3_NUM, (int)&endChild, 0, 0);
+	}
+	print("VN ok\nBROADCAST ok\n");
+
+	/* IRQSTATS: bad destination, a copy that clears, a copy after the clear */
+	check((int) SYSCALL(IRQSTATS_NUM, BADADDR, 0, 0) == ERROR_CONST, "IRQSTATS to NULL");
+	check((int) SYSCALL(IRQSTATS_NUM, (int)&stats, TRUE, 0) == SUCCESS_CONST, "IRQSTATS");
+	check(stats.st_lineAck[TERMINT].l_count > 0 && stats.st_lineDispatch[TERMINT].l_count > 0,
+		"IRQSTATS missed the terminal");
+	SYSCALL(IRQSTATS_NUM, (int)&stats, FALSE, 0);
+	check(stats.st_lineAck[TERMINT].l_count == 0, "IRQSTATS not cleared");
+	print("IRQSTATS ok\n");
+
+	/* TRACECTL: the previous mask back, syscalls recorded, unknown bits dropped, off */
+	mask = SYSCALL(TRACECTL_NUM, TRACE_SYSCALL, 0, 0);
+	check((int) SYSCALL(TRACECTL_NUM, TRACE_SYSCALL, 0, 0) == TRACE_SYSCALL, "TRACECTL previous mask");
+	n = traceNext;
+	SYSCALL(TRYP_NUM, (int)&a, 0, 0);
+	check(traceNext != n, "TRACECTL syscalls not recorded");
+	SYSCALL(TRACECTL_NUM, BADADDR, 0, 0);
+	check((int) SYSCALL(TRACECTL_NUM, 0, 0, 0) == TRACE_ALL, "TRACECTL unknown bits");
+	n = traceNext;
+	SYSCALL(TRYP_NUM, (int)&a, 0, 0);
+	check(traceNext == n, "TRACECTL off");
+	SYSCALL(TRACECTL_NUM, mask, 0, 0);
+	print("TRACECTL ok\n");
+
+	/* an extension number out of range kills a process with no support structure */
+	create(badChild);
+	SYSCALL(SYS7_NUM, 0, 0, 0);
+	check(!survived, "extension out of range");
+	print("out of range ok\n");
+
+	print("p2ext finishes OK -- TTFN\n");
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* SIGNALWAIT: the other end of the ping-pong */
+void pingChild() {
+
+	SYSCALL(SYS3_NUM, (int)&ping, 0, 0);
+	pinged = TRUE;
+	SYSCALL(SYS4_NUM, (int)&pong, 0, 0);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* MULTICALL: started by the first operation, wakes the second */
+void mcChild() {
+
+	SYSCALL(SYS3_NUM, (int)&childGo, 0, 0);
+	SYSCALL(SYS4_NUM, (int)&mcSem, 0, 0);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* TIMEDP: a V a tick later, well before the deadline */
+void timedChild() {
+
+	SYSCALL(SYS7_NUM, 0, 0, 0);
+	SYSCALL(SYS4_NUM, (int)&timedSem, 0, 0);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* WAITANY: a V on the second semaphore of the set, a tick later */
+void anyChild() {
+
+	SYSCALL(SYS7_NUM, 0, 0, 0);
+	SYSCALL(SYS4_NUM, (int)&anySem[1], 0, 0);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* WAITANY: wakes the test on anySem[0], then starts a terminal write nobody waits for */
+void devChild() {
+	devregtr *base = (devregtr *) (TERM0ADDR);
+
+	SYSCALL(SYS4_NUM, (int)&anySem[0], 0, 0);
+	*(base + 3) = PRINTCHR | (((devregtr) '.') << CHAR_SHIFT);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* VN and BROADCAST: tell the test it waits, in the same trap as the wait */
+void fanChild() {
+
+	SYSCALL(SIGNALWAIT_NUM, (int)&childReady, (int)&fanSem, 0);
+	SYSCALL(SYS4_NUM, (int)&endChild, 0, 0);
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+
+/* an extension number below the lowest one: the process must not come back */
+void badChild() {
+
+	SYSCALL(SYSEXT_MIN_NUM - 1, 0, 0, 0);
+	survived = TRUE;
+	SYSCALL(SYS2_NUM, 0, 0, 0);
+}
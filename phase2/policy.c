@@ -0,0 +1,704 @@
+/**********************************************************************************************
+ * policy.c
+ *
+ * @brief
+ * This file implements the scheduling policies of the nucleus. A policy is a scheduling class
+ * (sched_class_t): it owns its ready queue(s) and decides, through a small set of operations,
+ * where a ready process goes and which one runs next. The nucleus never touches a ready queue
+ * itself, every site (SYS1, V, I/O completion, pseudo-clock, PLT, terminate) goes through the
+ * active class schedClass (see the READY QUEUES helpers in scheduler.c).
+ *
+ * There are four policies:
+ *      - SCHED_RR: a single round-robin queue, every process gets the same PLT_TIME_SLICE.
+ *      - SCHED_MLFQ: MLFQ_LEVELS round-robin queues, dispatched from the top level.
+ *          - A process that uses its whole quantum is demoted one level (tick),
+ *          - A process that blocks for I/O or for the pseudo-clock goes back to the top level (block),
+ *          - Every MLFQ_BOOST_TICKS pseudo-clock ticks, every ready process goes back to the
+ *            top level (clockTick), so the CPU-bound processes in the lower levels are not starved.
+ *          The quantum doubles at each level down (MLFQ_TIME_SLICE).
+ *          A background process (p_background, the trace drain) is neither boosted nor sent back 
+ *          to the top level when it blocks: it stays on the lowest level.
+ *      - SCHED_PRIORITY: PRIO_LEVELS round-robin queues indexed by the static priority p_priority
+ *          (0 is the highest), with a bitmap of the non-empty ones. A child inherits the priority
+ *          of its parent unless SYS1 gives one (a3), and a process sets its own with SETPRIO.
+ *      - SCHED_CFS: completely fair, the ready processes are ordered by weighted virtual runtime
+ *          (charged from p_time) in a heap, the least served one runs next and the quantum is
+ *          CFS_LATENCY shared among the runnable processes.
+ *
+ * The default policy is chosen at build time (SCHED_POLICY in the Makefile, which defines
+ * SCHED_DEFAULT_POLICY), and it can be changed at run time with setSchedPolicy (SETSCHED syscall):
+ * the ready processes are drained from the old policy into the new one, so none is lost.
+ *
+ * The scheduling modes (schedModes, SCHED_MODES in the Makefile) are chosen the same way.
+ * With SCHED_WAKEUP_PREEMPT, a process woken by V or by an I/O completion preempts the
+ * current process when the policy says it should run first (sc_preempts): a higher MLFQ level,
+ * a higher priority, or (CFS) CFS_WAKEUP_GRANULARITY less virtual runtime.
+ * With SCHED_HANDOFF, a V that wakes a waiter gives it the rest of the caller's quantum
+ * (handoffProcessHelper in scheduler.c).
+ *
+ * @note
+ * The ready queues of every policy are set up at boot, so switching policy never allocates.
+ * A process only carries the fields of the policies (p_level, p_priority, p_vruntime), they are kept even
+ * when the policy that reads them is not active.
+ * A background process is placed low under every policy but RR, through those fields: the lowest MLFQ
+ * level (pinned there by p_background) and the lowest priority (PRIORITY, and the lightest CFS weight).
+ * RR has no placement, every process gets the same share.
+ *
+ * @author
+ * JaWeee Do
+ **********************************************************************************************/
+
+#include "../h/initial.h"
+#include "../h/policy.h"
+#include "../h/interrupts.h"
+#include "../h/types.h"
+#include "../h/const.h"
+#include "../h/pcb.h"
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------ Variables ----------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The active scheduling class and modes (SCHED_WAKEUP_PREEMPT) */
+sched_class_PTR schedClass;
+int schedModes;
+
+/* The ready queues of each policy */
+HIDDEN pcb_PTR rrQueue;
+HIDDEN pcb_PTR mlfqQueue[MLFQ_LEVELS];
+HIDDEN pcb_PTR prioQueue[PRIO_LEVELS];
+HIDDEN unsigned int prioBitmap; /* bit i is set when prioQueue[i] is not empty */
+
+/* The CFS heap (its root is the least served process), the sum of the weights in it
+and the virtual runtime of the least served process so far */
+HIDDEN pcb_PTR cfsRoot;
+HIDDEN int cfsLoad;
+HIDDEN cpu_t cfsMinVruntime;
+
+/* Count the pseudo-clock ticks since the last MLFQ priority boost */
+HIDDEN int ticks_since_boost;
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* -------------------------------------- SHARED OPERATIONS ------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**********************************************************************************************
+ * fixedTimeSliceHelper
+ *
+ * @brief
+ * The quantum of the policies that do not size it per process: PLT_TIME_SLICE.
+ *
+ * @param pcb_PTR process: the process to dispatch
+ * @return cpu_t: the quantum
+ * **********************************************************************************************/
+HIDDEN cpu_t fixedTimeSliceHelper(pcb_PTR process) {
+    return PLT_TIME_SLICE;
+}
+
+/**********************************************************************************************
+ * noClockTickHelper / noWakeQueueHelper
+ *
+ * @brief
+ * The clockTick operation of the policies that do not care about it, and the wakeQueue
+ * operation of the policies that place every woken process on its own.
+ * **********************************************************************************************/
+HIDDEN void noClockTickHelper() {
+}
+
+HIDDEN pcb_PTR *noWakeQueueHelper(int io_wait) {
+    return NULL;
+}
+
+/**********************************************************************************************
+ * neverPreemptsHelper
+ *
+ * @brief
+ * The preempts operation of the policies where a woken process simply waits for its turn.
+ * **********************************************************************************************/
+HIDDEN int neverPreemptsHelper(pcb_PTR process, pcb_PTR current) {
+    return FALSE;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ----------------------------------------- ROUND ROBIN ---------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+HIDDEN void rrInit() {
+    rrQueue = mkEmptyProcQ();
+}
+
+HIDDEN void rrEnqueue(pcb_PTR process) {
+    insertProcQ(&rrQueue, process);
+}
+
+/* The woken processes keep their order, behind the ready ones (concatProcQ walks them once) */
+HIDDEN void rrEnqueueAll(pcb_PTR *tp) {
+    concatProcQ(&rrQueue, tp);
+}
+
+/* Any batch of woken processes joins the queue as it is: removeAllBlocked splices it right in */
+HIDDEN pcb_PTR *rrWakeQueue(int io_wait) {
+    return &rrQueue;
+}
+
+HIDDEN pcb_PTR rrDequeue(pcb_PTR process) {
+    return outProcQ(&rrQueue, process);
+}
+
+HIDDEN pcb_PTR rrPickNext() {
+    return removeProcQ(&rrQueue);
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------ MULTI-LEVEL FEEDBACK ------------------------------------ */
+/* ---------------------------------------------------------------------------------------------- */
+
+HIDDEN void mlfqInit() {
+    int level;
+    for (level = 0; level < MLFQ_LEVELS; level++) {
+        mlfqQueue[level] = mkEmptyProcQ();
+    }
+    ticks_since_boost = 0;
+}
+
+HIDDEN void mlfqEnqueue(pcb_PTR process) {
+    insertProcQ(&mlfqQueue[process->p_level], process);
+}
+
+/* Processes woken together off a plain semaphore (VN, BROADCAST) may be on different levels: 
+   each one joins its own. The I/O and pseudo-clock waiters do not come here, see mlfqWakeQueue */
+HIDDEN void mlfqEnqueueAll(pcb_PTR *tp) {
+    pcb_PTR process;
+    while ((process = removeProcQ(tp)) != NULL) {
+        mlfqEnqueue(process);
+    }
+}
+
+/* The I/O and pseudo-clock waiters all went back to the top level when they blocked (mlfqBlock):
+   removeAllBlocked splices them right onto it */
+HIDDEN pcb_PTR *mlfqWakeQueue(int io_wait) {
+    return io_wait ? &mlfqQueue[MLFQ_TOP_LEVEL] : NULL;
+}
+
+HIDDEN pcb_PTR mlfqDequeue(pcb_PTR process) {
+    return outProcQ(&mlfqQueue[process->p_level], process);
+}
+
+/* The head of the highest (smallest index) non-empty level */
+HIDDEN pcb_PTR mlfqPickNext() {
+    int level;
+    for (level = MLFQ_TOP_LEVEL; level < MLFQ_LEVELS; level++) {
+        if (!emptyProcQ(mlfqQueue[level])) {
+            return removeProcQ(&mlfqQueue[level]);
+        }
+    }
+    return NULL;
+}
+
+HIDDEN cpu_t mlfqTimeSlice(pcb_PTR process) {
+    return MLFQ_TIME_SLICE(process->p_level);
+}
+
+/* The process used its whole quantum: one level down (unless already at the lowest) */
+HIDDEN void mlfqTick(pcb_PTR process) {
+    if (process->p_level < MLFQ_LEVELS - 1) {
+        process->p_level++;
+    }
+    mlfqEnqueue(process);
+}
+
+/* The process waits for I/O or for the pseudo-clock: it wakes up on the top level.
+   It is the block operation of every policy, so a waiter is on the top level whichever 
+   policy it blocked under, and a switch to MLFQ can still splice it there (mlfqWakeQueue).
+   A background process stays on the lowest level (it never waits for I/O or the pseudo-clock) */
+HIDDEN void mlfqBlock(pcb_PTR process) {
+    if (!process->p_background) {
+        process->p_level = MLFQ_TOP_LEVEL;
+    }
+}
+
+/* A woken process on a higher level runs first */
+HIDDEN int mlfqPreempts(pcb_PTR process, pcb_PTR current) {
+    return process->p_level < current->p_level;
+}
+
+/**********************************************************************************************
+ * mlfqClockTick
+ *
+ * @brief
+ * This function is the periodic priority boost: every MLFQ_BOOST_TICKS pseudo-clock ticks,
+ * every ready process (and the current one) goes back to the top MLFQ level.
+ *
+ * @protocol
+ * 1. Count the tick, do nothing until MLFQ_BOOST_TICKS ticks went by
+ * 2. For each level below the top, set the level (and p_queue) of each of its processes to the top
+ *    level in one walk, and append the whole queue to the top level queue in one splice 
+ *    (spliceProcQ keeps the round-robin order).
+ *    If the walk met a background process, the level is moved one process at a time instead,
+ *    and the background processes stay on it
+ * 3. Boost the current process, unless it is a background process
+ *
+ * @note
+ * Only the trace drain is a background process, and it is on a ready queue only while it has
+ * records to stream: the slow path of step 2 is rare.
+ *
+ * @return void
+ * **********************************************************************************************/
+HIDDEN void mlfqClockTick() {
+    int level, background;
+    pcb_PTR process, keep;
+
+    /* Step 1: count the tick */
+    ticks_since_boost++;
+    if (ticks_since_boost < MLFQ_BOOST_TICKS) {
+        return;
+    }
+    ticks_since_boost = 0;
+
+    for (level = MLFQ_TOP_LEVEL + 1; level < MLFQ_LEVELS; level++) {
+        if (emptyProcQ(mlfqQueue[level])) {
+            continue;
+        }
+
+        /* Step 2: every process of the level goes to the top, the whole queue at once */
+        background = 0;
+        process = mlfqQueue[level];
+        do {
+            if (process->p_background) {
+                background++;
+            } else {
+                process->p_level = MLFQ_TOP_LEVEL;
+                process->p_queue = &mlfqQueue[MLFQ_TOP_LEVEL];
+            }
+            process = process->p_next;
+        } while (process != mlfqQueue[level]);
+
+        if (background == 0) {
+            spliceProcQ(&mlfqQueue[MLFQ_TOP_LEVEL], &mlfqQueue[level]);
+            continue;
+        }
+
+        /* a background process stays: the others go one at a time (insertProcQ sets p_queue) */
+        keep = mkEmptyProcQ();
+        while ((process = removeProcQ(&mlfqQueue[level])) != NULL) {
+            insertProcQ(process->p_background ? &keep : &mlfqQueue[MLFQ_TOP_LEVEL], process);
+        }
+        mlfqQueue[level] = keep;
+    }
+
+    /* Step 3: the current process too */
+    if (currentProcess != NULL && !currentProcess->p_background) {
+        currentProcess->p_level = MLFQ_TOP_LEVEL;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* --------------------------------------- STATIC PRIORITY -------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+HIDDEN void prioInit() {
+    int priority;
+    for (priority = 0; priority < PRIO_LEVELS; priority++) {
+        prioQueue[priority] = mkEmptyProcQ();
+    }
+    prioBitmap = 0;
+}
+
+HIDDEN void prioEnqueue(pcb_PTR process) {
+    insertProcQ(&prioQueue[process->p_priority], process);
+    prioBitmap |= (1 << process->p_priority);
+}
+
+HIDDEN void prioEnqueueAll(pcb_PTR *tp) {
+    pcb_PTR process;
+    while ((process = removeProcQ(tp)) != NULL) {
+        prioEnqueue(process);
+    }
+}
+
+HIDDEN pcb_PTR prioDequeue(pcb_PTR process) {
+    pcb_PTR removed = outProcQ(&prioQueue[process->p_priority], process);
+
+    if (emptyProcQ(prioQueue[process->p_priority])) {
+        prioBitmap &= ~(1 << process->p_priority);
+    }
+    return removed;
+}
+
+/* A woken process with a higher priority runs first */
+HIDDEN int prioPreempts(pcb_PTR process, pcb_PTR current) {
+    return process->p_priority < current->p_priority;
+}
+
+/**********************************************************************************************
+ * prioPickNext
+ *
+ * @brief
+ * This function removes and returns the head of the highest (smallest index) non-empty
+ * priority. The highest priority is the lowest set bit of prioBitmap (PRIO_LEVELS bits), read 
+ * from lowestBitTable in one lookup, so it does not scan the empty queues.
+ *
+ * @return pcb_PTR: the next process to run, or NULL if no process is ready
+ * **********************************************************************************************/
+HIDDEN pcb_PTR prioPickNext() {
+    int priority;
+    pcb_PTR process;
+
+    if (prioBitmap == 0) {
+        return NULL;
+    }
+
+    /* the lowest set bit */
+    priority = lowestBitTable[prioBitmap];
+
+    process = removeProcQ(&prioQueue[priority]);
+    if (emptyProcQ(prioQueue[priority])) {
+        prioBitmap &= ~(1 << priority);
+    }
+    return process;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------ COMPLETELY FAIR (CFS) ----------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**********************************************************************************************
+ * CFS
+ *
+ * @brief
+ * The ready processes are kept in a pairing heap ordered by weighted virtual runtime
+ * (p_vruntime), the heap links live in the pcb (p_hChild, p_hSib, p_hPrev) so the heap never
+ * allocates and has no size limit. The process with the smallest virtual runtime, the least
+ * served one, always runs next.
+ *
+ * The CPU time is read from p_time (updateProcessTimeHelper): when a process becomes ready
+ * again, the time it used since it was last charged (p_vcharged) is added to its virtual
+ * runtime, scaled by CFS_NICE0_WEIGHT / weight. The weight comes from the static priority, so
+ * two competing processes get CPU time (SYS6) in the ratio of their weights.
+ *
+ * The quantum is the share of CFS_LATENCY of the process among the runnable ones (in weight),
+ * but never less than CFS_MIN_GRANULARITY.
+ *
+ * @note
+ * A process that slept (or a new one) is placed no further than CFS_LATENCY / 2 behind the
+ * least served ready process (cfsMinVruntime), so it runs soon but cannot hog the CPU to
+ * catch up. The virtual runtimes are compared through their difference, so they may wrap.
+ * **********************************************************************************************/
+
+/* CFS weight of each static priority (priority PRIO_DEFAULT weighs CFS_NICE0_WEIGHT) */
+HIDDEN int cfsWeight[PRIO_LEVELS] = { 3121, 2501, 1991, 1586, 1024, 820, 655, 526 };
+
+/* a is served less than b */
+#define VRUNTIME_BEFORE(a, b)   (((a)->p_vruntime - (b)->p_vruntime) < 0)
+
+HIDDEN void cfsInit() {
+    cfsRoot = NULL;
+    cfsLoad = 0;
+    cfsMinVruntime = 0;
+}
+
+/**********************************************************************************************
+ * cfsMeldHelper
+ *
+ * @brief
+ * This function melds two heaps: the root served more becomes the first child of the other.
+ *
+ * @param pcb_PTR a, b: the roots of the heaps (NULL for an empty heap)
+ * @return pcb_PTR: the root of the melded heap
+ * **********************************************************************************************/
+HIDDEN pcb_PTR cfsMeldHelper(pcb_PTR a, pcb_PTR b) {
+    pcb_PTR tmp;
+
+    if (a == NULL) {
+        return b;
+    }
+    if (b == NULL) {
+        return a;
+    }
+    if (VRUNTIME_BEFORE(b, a)) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    /* b becomes the first child of a */
+    b->p_hPrev = a;
+    b->p_hSib = a->p_hChild;
+    if (a->p_hChild != NULL) {
+        a->p_hChild->p_hPrev = b;
+    }
+    a->p_hChild = b;
+    return a;
+}
+
+/**********************************************************************************************
+ * cfsMergePairsHelper
+ *
+ * @brief
+ * This function melds a list of sibling heaps into one heap (the two-pass pairing).
+ *
+ * @protocol
+ * 1. Left to right, meld the siblings in pairs, the melded pairs are pushed on a stack
+ *    (chained through p_hSib)
+ * 2. Pop the stack (right to left), melding every pair into the result
+ *
+ * @param pcb_PTR first: the first sibling (NULL for none)
+ * @return pcb_PTR: the root of the heap, with no sibling and no parent
+ * **********************************************************************************************/
+HIDDEN pcb_PTR cfsMergePairsHelper(pcb_PTR first) {
+    pcb_PTR a, b, next, pairs, result;
+
+    /* Step 1: meld in pairs */
+    pairs = NULL;
+    while (first != NULL) {
+        a = first;
+        b = a->p_hSib;
+        next = (b != NULL) ? b->p_hSib : NULL;
+        a->p_hSib = NULL;
+        a->p_hPrev = NULL;
+        if (b != NULL) {
+            b->p_hSib = NULL;
+            b->p_hPrev = NULL;
+        }
+        a = cfsMeldHelper(a, b);
+        a->p_hSib = pairs;
+        pairs = a;
+        first = next;
+    }
+
+    /* Step 2: meld the pairs back */
+    result = NULL;
+    while (pairs != NULL) {
+        next = pairs->p_hSib;
+        pairs->p_hSib = NULL;
+        result = cfsMeldHelper(result, pairs);
+        pairs = next;
+    }
+
+    if (result != NULL) {
+        result->p_hPrev = NULL;
+    }
+    return result;
+}
+
+/**********************************************************************************************
+ * cfsChargeHelper
+ *
+ * @brief
+ * This function charges the virtual runtime of a process with the CPU time (p_time) it used
+ * since it was last charged, weighted: delta * CFS_NICE0_WEIGHT / weight.
+ *
+ * @param pcb_PTR process: the process to charge
+ * @return void
+ * **********************************************************************************************/
+HIDDEN void cfsChargeHelper(pcb_PTR process) {
+    int weight = cfsWeight[process->p_priority];
+    cpu_t delta = process->p_time - process->p_vcharged;
+
+    /* (delta * NICE0 / weight) without overflowing */
+    process->p_vruntime += (delta / weight) * CFS_NICE0_WEIGHT
+                        + ((delta % weight) * CFS_NICE0_WEIGHT) / weight;
+    process->p_vcharged = process->p_time;
+}
+
+/**********************************************************************************************
+ * cfsEnqueue
+ *
+ * @brief
+ * This function charges a process the CPU time it used since it was last charged,
+ * then inserts it in the heap.
+ *
+ * @protocol
+ * 1. Charge p_time - p_vcharged, weighted, to the virtual runtime
+ * 2. Do not leave it more than CFS_LATENCY / 2 behind the least served process
+ * 3. Insert it in the heap and add its weight to the load
+ *
+ * @param pcb_PTR process: the process that is ready to run
+ * @return void
+ * **********************************************************************************************/
+HIDDEN void cfsEnqueue(pcb_PTR process) {
+    int weight = cfsWeight[process->p_priority];
+
+    /* Step 1: charge the time used */
+    cfsChargeHelper(process);
+
+    /* Step 2: sleepers and new processes join near the least served one */
+    if (process->p_vruntime - (cfsMinVruntime - CFS_LATENCY / 2) < 0) {
+        process->p_vruntime = cfsMinVruntime - CFS_LATENCY / 2;
+    }
+
+    /* Step 3: insert */
+    process->p_hChild = NULL;
+    process->p_hSib = NULL;
+    process->p_hPrev = NULL;
+    cfsRoot = cfsMeldHelper(cfsRoot, process);
+    cfsLoad += weight;
+}
+
+HIDDEN void cfsEnqueueAll(pcb_PTR *tp) {
+    pcb_PTR process;
+    while ((process = removeProcQ(tp)) != NULL) {
+        cfsEnqueue(process);
+    }
+}
+
+/**********************************************************************************************
+ * cfsDequeue
+ *
+ * @brief
+ * This function takes any process out of the heap.
+ *
+ * @protocol
+ * 1. A process is in the heap if it is the root or has a p_hPrev (parent or left sibling)
+ * 2. The root: its children are melded into the new root
+ * 3. Otherwise: cut its subtree off its parent (or left sibling), meld its children and
+ *    meld the result back into the heap
+ *
+ * @param pcb_PTR process: the process to take out
+ * @return pcb_PTR: the process, or NULL if it was not in the heap
+ * **********************************************************************************************/
+HIDDEN pcb_PTR cfsDequeue(pcb_PTR process) {
+    pcb_PTR subtree;
+
+    /* Step 1: is it in the heap */
+    if (process != cfsRoot && process->p_hPrev == NULL) {
+        return NULL;
+    }
+
+    if (process == cfsRoot) {
+        /* Step 2: the root */
+        cfsRoot = cfsMergePairsHelper(process->p_hChild);
+    } else {
+        /* Step 3: cut the subtree, p_hPrev is the parent when it is the first child */
+        if (process->p_hPrev->p_hChild == process) {
+            process->p_hPrev->p_hChild = process->p_hSib;
+        } else {
+            process->p_hPrev->p_hSib = process->p_hSib;
+        }
+        if (process->p_hSib != NULL) {
+            process->p_hSib->p_hPrev = process->p_hPrev;
+        }
+        subtree = cfsMergePairsHelper(process->p_hChild);
+        cfsRoot = cfsMeldHelper(cfsRoot, subtree);
+    }
+
+    process->p_hChild = NULL;
+    process->p_hSib = NULL;
+    process->p_hPrev = NULL;
+    cfsLoad -= cfsWeight[process->p_priority];
+    return process;
+}
+
+/* The least served process; the least virtual runtime only moves forward */
+HIDDEN pcb_PTR cfsPickNext() {
+    pcb_PTR process = cfsRoot;
+
+    if (process == NULL) {
+        return NULL;
+    }
+    cfsDequeue(process);
+    if (cfsMinVruntime - process->p_vruntime < 0) {
+        cfsMinVruntime = process->p_vruntime;
+    }
+    return process;
+}
+
+/* A woken process runs first if it is CFS_WAKEUP_GRANULARITY less served than the current one */
+HIDDEN int cfsPreempts(pcb_PTR process, pcb_PTR current) {
+    cfsChargeHelper(current);
+    return (process->p_vruntime + CFS_WAKEUP_GRANULARITY) - current->p_vruntime < 0;
+}
+
+/* Its weighted share of CFS_LATENCY among the runnable processes (itself and the ready ones) */
+HIDDEN cpu_t cfsTimeSlice(pcb_PTR process) {
+    int weight = cfsWeight[process->p_priority];
+    cpu_t slice = (CFS_LATENCY * weight) / (cfsLoad + weight);
+
+    return (slice < CFS_MIN_GRANULARITY) ? CFS_MIN_GRANULARITY : slice;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------ POLICIES ------------------------------------------ */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The scheduling classes, indexed by SCHED_RR, SCHED_MLFQ, SCHED_PRIORITY, SCHED_CFS */
+HIDDEN sched_class_t schedClasses[SCHED_POLICY_COUNT] = {
+    { rrInit, rrEnqueue, rrEnqueueAll, rrWakeQueue, rrDequeue, rrPickNext,
+      fixedTimeSliceHelper, rrEnqueue, rrEnqueue, mlfqBlock, noClockTickHelper,
+      neverPreemptsHelper },
+    { mlfqInit, mlfqEnqueue, mlfqEnqueueAll, mlfqWakeQueue, mlfqDequeue, mlfqPickNext,
+      mlfqTimeSlice, mlfqTick, mlfqEnqueue, mlfqBlock, mlfqClockTick,
+      mlfqPreempts },
+    { prioInit, prioEnqueue, prioEnqueueAll, noWakeQueueHelper, prioDequeue, prioPickNext,
+      fixedTimeSliceHelper, prioEnqueue, prioEnqueue, mlfqBlock, noClockTickHelper,
+      prioPreempts },
+    { cfsInit, cfsEnqueue, cfsEnqueueAll, noWakeQueueHelper, cfsDequeue, cfsPickNext,
+      cfsTimeSlice, cfsEnqueue, cfsEnqueue, mlfqBlock, noClockTickHelper,
+      cfsPreempts }
+};
+
+/**********************************************************************************************
+ * initSchedPolicy
+ *
+ * @brief
+ * This function sets up the (empty) ready queues of every policy and activates the
+ * build-time default one, SCHED_DEFAULT_POLICY, with the modes SCHED_DEFAULT_MODES.
+ *
+ * @return void
+ * **********************************************************************************************/
+void initSchedPolicy() {
+    int policy;
+    for (policy = 0; policy < SCHED_POLICY_COUNT; policy++) {
+        schedClasses[policy].sc_init();
+    }
+    schedClass = &schedClasses[SCHED_DEFAULT_POLICY];
+    schedModes = SCHED_DEFAULT_MODES;
+}
+
+/**********************************************************************************************
+ * setSchedPolicy
+ *
+ * @brief
+ * This function activates another scheduling policy, and the scheduling modes.
+ *
+ * @protocol
+ * 1. Reject an unknown policy or mode
+ * 2. Drain every ready process from the old policy, in its dispatch order, into the new one
+ * 3. Activate the new policy and modes
+ *
+ * @note
+ * The current process is not ready, the caller gives it to the new policy (e.g. with sc_yield).
+ *
+ * @param int policy: SCHED_RR, SCHED_MLFQ, SCHED_PRIORITY or SCHED_CFS
+ * @param int modes: the SCHED_MODES_ALL bits to set (the others are cleared)
+ * @return int: the previous policy, or ERROR_CONST if the policy or a mode is unknown
+ * **********************************************************************************************/
+int setSchedPolicy(int policy, int modes) {
+    sched_class_PTR old_class;
+    pcb_PTR process;
+
+    /* Step 1: reject an unknown policy or mode */
+    if (policy < 0 || policy >= SCHED_POLICY_COUNT || (modes & ~SCHED_MODES_ALL) != 0) {
+        return ERROR_CONST;
+    }
+
+    /* Step 2: move the ready processes */
+    old_class = schedClass;
+    if (old_class != &schedClasses[policy]) {
+        while ((process = old_class->sc_pickNext()) != NULL) {
+            schedClasses[policy].sc_enqueue(process);
+        }
+    }
+
+    /* Step 3: activate the new policy and modes */
+    schedClass = &schedClasses[policy];
+    schedModes = modes;
+    return old_class - schedClasses;
+}
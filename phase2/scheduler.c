@@ -19,6 +19,12 @@
  * Without proper context switching and scheduling, processes could not share the CPU effectively, leading 
  * to poor resource utilization and system instability.
  * 
+ * Scheduling policies: The ready queue belongs to the active scheduling class (schedClass, see
+ * policy.c): round-robin, multi-level feedback queue, static priority or completely fair (CFS).
+ * Every site that makes a process ready, takes it out, preempts it or blocks it for I/O goes 
+ * through the READY QUEUES helpers below, which forward to the active class. The scheduler asks 
+ * the class for the next process and for the PLT quantum to give it.
+ *
  * This also provide a helper function to move the state from one state to another state
  * This can be used to move the state from the source to the destination by carefully copying 
  * each field of the state structure. For example, we can use it to return the state of the 
@@ -29,6 +35,8 @@
  * The purpose of switching contexts is to save the current execution state, update the
  * current process pointer, record the current time so that it can resume execution. 
  * This also upfate the start time of the process when this process reutnr to the CPU.
+ * - resumeContext()
+ * The same for the current process, straight from the exception state in the BIOS data page.
  *
  * @note
  * In the scheduler (LAST CASE), if the ready queue is empty and there are still processes in the system 
@@ -44,8 +52,10 @@
 
 #include "../h/initial.h"
 #include "../h/scheduler.h"
+#include "../h/policy.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/trace.h"
 #include "../h/types.h"
 #include "../h/const.h"
 #include "../h/asl.h"
@@ -53,6 +63,264 @@
 #include "/usr/include/umps3/umps/libumps.h"
 
 
+/* ---------------------------------------------------------------------------------------------- */
+/* ----------------------------------------- READY QUEUES --------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**********************************************************************************************
+ * insertReadyQueueHelper
+ * 
+ * @brief
+ * This function makes a process ready to run, the active policy decides where it goes.
+ * 
+ * @param pcb_PTR process: the process that is ready to run
+ * @return void
+ * **********************************************************************************************/
+void insertReadyQueueHelper(pcb_PTR process) {
+    schedClass->sc_enqueue(process);
+}
+
+/**********************************************************************************************
+ * insertAllReadyQueueHelper
+ * 
+ * @brief
+ * This function makes every process of a queue ready to run (e.g. the pseudo-clock sleepers),
+ * the queue is left empty. Every caller unblocks them, so they are traced as unblocks.
+ * 
+ * @param pcb_PTR *tp: the tail pointer of the queue
+ * @return void
+ * **********************************************************************************************/
+void insertAllReadyQueueHelper(pcb_PTR *tp) {
+    if (traceMask & TRACE_BLOCK) {
+        traceAllHelper(TRACE_EV_UNBLOCK, *tp, NULL);
+    }
+    schedClass->sc_enqueueAll(tp);
+}
+
+/**********************************************************************************************
+ * wakeAllBlockedHelper
+ * 
+ * @brief
+ * This function makes every process blocked on a semaphore ready to run at once 
+ * (e.g. the pseudo-clock sleepers, a BROADCAST), a WAITANY among them through its owner.
+ * 
+ * @protocol
+ * 1. Ask the policy for the ready queue the woken processes can join as they are (sc_wakeQueue)
+ * 2. If there is one, remove them from the ASL right onto it: removeAllBlocked sets their p_queue 
+ *    on its walk and splices them in constant time. Claim the WAITANY proxies among them 
+ *    (claimAllWaitersHelper, from the former tail of the ready queue on) and trace them
+ * 3. Otherwise remove them onto a queue of their own, claim the proxies, and hand the queue 
+ *    to the policy (insertAllReadyQueueHelper)
+ * 
+ * @param int *semaphore: the semaphore
+ * @param int io_wait: TRUE if they all went through sc_block (I/O or pseudo-clock waiters)
+ * @param int irq_index: the device index of the interrupt that wakes them, NO_IRQ if none
+ * @param cpu_t irq_TOD: the TOD of that interrupt
+ * @return int: the number of pcbs taken off the semaphore
+ * **********************************************************************************************/
+int wakeAllBlockedHelper(int *semaphore, int io_wait, int irq_index, cpu_t irq_TOD) {
+    pcb_PTR *ready_queue = schedClass->sc_wakeQueue(io_wait);
+    pcb_PTR woken_queue, last_ready;
+    int woken_count;
+
+    if (ready_queue != NULL) {
+        /* Step 2: straight onto the ready queue */
+        last_ready = *ready_queue;
+        woken_count = removeAllBlocked(semaphore, ready_queue, irq_index, irq_TOD);
+        claimAllWaitersHelper(ready_queue, last_ready, woken_count);
+        if (traceMask & TRACE_BLOCK) {
+            traceAllHelper(TRACE_EV_UNBLOCK, *ready_queue, last_ready);
+        }
+    } else {
+        /* Step 3: through the policy */
+        woken_queue = mkEmptyProcQ();
+        woken_count = removeAllBlocked(semaphore, &woken_queue, irq_index, irq_TOD);
+        claimAllWaitersHelper(&woken_queue, NULL, woken_count);
+        insertAllReadyQueueHelper(&woken_queue);
+    }
+    return woken_count;
+}
+
+/**********************************************************************************************
+ * preemptsCurrentHelper
+ * 
+ * @brief
+ * This function tells whether a process just made ready should take the CPU from the current
+ * process: only in SCHED_WAKEUP_PREEMPT mode, and if the active policy prefers it.
+ * 
+ * @param pcb_PTR process: the woken process
+ * @return int: TRUE if it should preempt the current process (which must exist), FALSE otherwise
+ * **********************************************************************************************/
+int preemptsCurrentHelper(pcb_PTR process) {
+    return (schedModes & SCHED_WAKEUP_PREEMPT) && schedClass->sc_preempts(process, currentProcess);
+}
+
+/**********************************************************************************************
+ * wakeProcessHelper
+ * 
+ * @brief
+ * This function makes a process that was just unblocked (V, I/O completion) ready to run.
+ * In SCHED_WAKEUP_PREEMPT mode, if the active policy says it should run before the current
+ * process, the current process goes back to the ready queue and the woken one is dispatched
+ * at once with a fresh quantum; this function does not return then.
+ * 
+ * @protocol
+ * 1. Make the woken process ready (the policy places it, e.g. CFS charges it)
+ * 2. If the mode is on and the policy prefers it to the current process:
+ *      - take it back out of the ready queue,
+ *      - the current process yields (it is ready again, its quantum is lost),
+ *      - load the quantum of the woken process on the PLT and switch to it
+ * 
+ * @note
+ * The caller must have saved the state of the current process in its pcb and charged its
+ * CPU time (p_time) up to now, since the current process may not be resumed by the caller.
+ * 
+ * @param pcb_PTR process: the woken process
+ * @return void
+ * **********************************************************************************************/
+void wakeProcessHelper(pcb_PTR process) {
+    /* Step 1: make it ready */
+    TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, process, process->p_s.s_v0, 0, 0, 0);
+    schedClass->sc_enqueue(process);
+
+    /* Step 2: preempt the current process */
+    if (currentProcess != NULL && preemptsCurrentHelper(process)) {
+        schedClass->sc_dequeue(process);
+        schedClass->sc_yield(currentProcess);
+        currentProcess = process;
+        setTIMER(schedClass->sc_timeSlice(process));
+        switchContext(process);
+    }
+}
+
+/**********************************************************************************************
+ * handoffProcessHelper
+ * 
+ * @brief
+ * This function is the directed handoff of SCHED_HANDOFF mode: the current process, which just
+ * woke a process with a V, gives it the rest of its quantum. The current process goes back to
+ * the ready queue (unless it just blocked, see SIGNALWAIT) and the woken one runs at once, for 
+ * what is left on the PLT; this function does not return then. When nothing is left of the 
+ * quantum, it returns without doing anything (the caller wakes the process as usual).
+ * 
+ * @protocol
+ * 1. Read what is left of the quantum of the current process, return if nothing
+ * 2. Pass the woken process through the policy (e.g. CFS charges it) and take it back out
+ * 3. The current process (if it did not block) yields, it is ready again
+ * 4. Switch to the woken process with the rest of the quantum on the PLT
+ * 
+ * @note
+ * Like wakeProcessHelper, the caller must have saved the state and charged the CPU time of the
+ * current process. This way a semaphore ping-pong costs a single context switch per V.
+ * 
+ * @param pcb_PTR process: the woken process
+ * @return void
+ * **********************************************************************************************/
+void handoffProcessHelper(pcb_PTR process) {
+    /* Step 1: what is left of the quantum */
+    cpu_t time_left = (cpu_t) getTIMER();
+    if (time_left <= 0) {
+        return;
+    }
+
+    /* Step 2: through the policy */
+    TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, process, process->p_s.s_v0, 0, 0, 0);
+    schedClass->sc_enqueue(process);
+    schedClass->sc_dequeue(process);
+
+    /* Step 3: the current process is ready again */
+    if (currentProcess != NULL) {
+        schedClass->sc_yield(currentProcess);
+    }
+
+    /* Step 4: the woken process runs on the donated time */
+    currentProcess = process;
+    setTIMER(time_left);
+    switchContext(process);
+}
+
+/**********************************************************************************************
+ * outReadyQueueHelper
+ * 
+ * @brief
+ * This function takes a process out of the ready queue(s).
+ * 
+ * @param pcb_PTR process: the process to take out
+ * @return pcb_PTR: the process, or NULL if it was not ready
+ * **********************************************************************************************/
+pcb_PTR outReadyQueueHelper(pcb_PTR process) {
+    return schedClass->sc_dequeue(process);
+}
+
+/**********************************************************************************************
+ * removeReadyQueueHelper
+ * 
+ * @brief
+ * This function removes and returns the process the active policy wants to run next.
+ * 
+ * @return pcb_PTR: the next process to run, or NULL if no process is ready
+ * **********************************************************************************************/
+pcb_PTR removeReadyQueueHelper() {
+    return schedClass->sc_pickNext();
+}
+
+/**********************************************************************************************
+ * expiredProcessHelper
+ * 
+ * @brief
+ * This function makes ready again a process that used its whole quantum (PLT interrupt),
+ * the policy may lower it (e.g. MLFQ demotion).
+ * 
+ * @param pcb_PTR process: the preempted process, not on a ready queue
+ * @return void
+ * **********************************************************************************************/
+void expiredProcessHelper(pcb_PTR process) {
+    schedClass->sc_tick(process);
+}
+
+/**********************************************************************************************
+ * yieldProcessHelper
+ * 
+ * @brief
+ * This function makes ready again a process that gave the CPU up before its quantum ended.
+ * 
+ * @param pcb_PTR process: the process, not on a ready queue
+ * @return void
+ * **********************************************************************************************/
+void yieldProcessHelper(pcb_PTR process) {
+    schedClass->sc_yield(process);
+}
+
+/**********************************************************************************************
+ * ioWaitProcessHelper
+ * 
+ * @brief
+ * This function tells the policy that a process is about to block for I/O or for the 
+ * pseudo-clock (e.g. MLFQ puts it back on the top level).
+ * 
+ * @param pcb_PTR process: the process about to block
+ * @return void
+ * **********************************************************************************************/
+void ioWaitProcessHelper(pcb_PTR process) {
+    schedClass->sc_block(process);
+}
+
+/**********************************************************************************************
+ * clockTickHelper
+ * 
+ * @brief
+ * This function tells the policy that the pseudo-clock ticked (e.g. MLFQ priority boost).
+ * 
+ * @return void
+ * **********************************************************************************************/
+void clockTickHelper() {
+    schedClass->sc_clockTick();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------ SCHEDULER ----------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
 /**********************************************************************************************
  * switchContext
  * 
@@ -77,8 +345,12 @@
  * @return void
  * **********************************************************************************************/
 void switchContext(pcb_PTR target_process) {
-    /* Step 1: set the process */
+    /* Step 1: set the process (if an interrupt woke it, record how long it waited, see irqDispatchHelper) */
     currentProcess = target_process;
+    irqDispatchHelper(target_process);
+    if (traceMask & (TRACE_SWITCH | TRACE_SYSCALL)) {
+        traceDispatchHelper(target_process, &(target_process->p_s));
+    }
 
     /* Step 2: save the current time when retuirn to the rpocess */
     STCK(start_TOD);
@@ -98,15 +370,16 @@ void switchContext(pcb_PTR target_process) {
  *
  * @protocol
  * 1. If the Ready Queue is not empty:
- *    - Remove the process from the head of the Ready Queue.
+ *    - Remove the process the active policy picks.
  *    - Set currentProcess to the removed process.
- *    - Load 5 milliseconds on the Programmable Interval Timer (PLT).
+ *    - Load the quantum the policy gives it on the Programmable Interval Timer (PLT).
  *    - Load the state of the current process to resume its execution.
  * 2. If the Ready Queue is empty:
  *    - If processCount is 0:
  *         - There are no processes in the system; the system halts via HALT().
- *    - If softBlockedCount is >0:
- *         - Some processes are waiting for an event; the system enables interrupts,
+ *    - If softBlockedCount is >0, or a timed P is pending, or the trace drain is the only process left:
+ *         - Some processes are waiting for an event; the system is idle, so it gives the 
+ *           unused PCB and semaphore slabs back to the frame pool, then enables interrupts,
  *           disables the PLT by loading a very large time value, and waits for an event.
  *    - Otherwise:
  *         - A deadlock has been detected; the system cannot make progress and PANIC() is invoked.
@@ -116,22 +389,26 @@ void switchContext(pcb_PTR target_process) {
  * in the system (processCount > 0), it indicates that all processes are neither ready nor waiting
  * for an external event. This scenario represents a deadlock, as no processes can make progress.
  * In this case, the system calls PANIC() to indicate an unrecoverable system state.
+ * The trace drain (traceDrain) sleeps on a semaphore of its own, not on the pseudo-clock, so it
+ * is not in softBlockedCount: counted, it would keep it above 0 and hide the deadlock forever.
+ * Alone, it is waited for: the next tick wakes it up, it streams the last records and terminates.
  * 
  * @return void
  * **********************************************************************************************/
 void scheduler() {
     pcb_PTR next_process;
 
+    /* Step 1: Remove the pcb the active policy picks */
+    next_process = removeReadyQueueHelper();
+
     /* If the Ready Queue is not empty, dispatch the next process */
-    if (!emptyProcQ(readyQueue)) {
-        /* Step 1: Remove the pcb from the head of the Ready Queue */
-        next_process = removeProcQ(&readyQueue);
+    if (next_process != NULL) {
         
         /* Store pointer to the PCB in the Current Process field */
         currentProcess = next_process;
         
-        /* Step 2: Load 5 milliseconds on the PLT */
-        setTIMER(PLT_TIME_SLICE);
+        /* Step 2: Load its quantum on the PLT */
+        setTIMER(schedClass->sc_timeSlice(currentProcess));
         
         /* Step 3: Load the processor state of the current process */
         switchContext(currentProcess);
@@ -143,8 +420,13 @@ void scheduler() {
         if (processCount == 0) {
             HALT();
         }
-        /* Case 2: If processes exist but some are blocked waiting for events */
-        else if (softBlockedCount > 0) {
+        /* Case 2: If processes exist but some are blocked waiting for events, or only the drain */
+        else if (softBlockedCount > 0 || headTimeout() != NULL || 
+                 processCount == traceDrainActive) {
+            /* The system is idle: give the unused PCB and semaphore slabs back */
+            shrinkPcbs();
+            shrinkSemds();
+
             /* Enable interrupts and disable PLT before waiting */
             setSTATUS(ALLOFF | IMON | IECON);
             setTIMER(INF_TIME);
@@ -170,29 +452,93 @@ void scheduler() {
  * This helper function move the info from one state to another state
  * 
  * @protocol
- * 1. copy all the field
- * 2. copy all the general purpose registers
+ * 1. Look at both states as STATE_COPY_WORDS words, and copy the 4 fields
+ * 2. Copy the general purpose registers (word 4 on)
+ * Two words at a time: both loads first, then both stores
  * 
  * @note
  * as in C is shallow copy, we move the state from the source to the destination by carefully
  * copying each field of the state structure.
- * We also have to take care all thesysCallOutRangeHandler(); general purpose registers associated with the state
+ * It runs on the way in of every exception that saves a state (syscall, PLT, pass up, SYS1), so
+ * the copy is fully unrolled: no loop counter, no branch, one load and one store per word.
+ * The nucleus is built without -O, so the pointers and the two words are register variables
+ * (gcc keeps them in registers even then), and the second load of a pair sits in the load
+ * delay slot of the first. p2bench.c measures it against the field by field copy it replaced.
+ * A plain struct assignment is not used, the compiler may turn it into a memcpy call that 
+ * the nucleus (-nostdlib) does not have.
  * 
  * @param source_state: the source state
  * @param destination_state: the destination state
  * @return void
 *********************************************************************************************/
+
+/* Copy words i and i + 1 of the state */
+#define STATE_COPY_PAIR(i) \
+    do { \
+        w0 = source[i]; \
+        w1 = source[(i) + 1]; \
+        destination[i] = w0; \
+        destination[(i) + 1] = w1; \
+    } while (0)
+
 void moveStateHelper(state_PTR source_state, state_PTR destination_state){
+    register unsigned int *source = (unsigned int *) source_state;
+    register unsigned int *destination = (unsigned int *) destination_state;
+    register unsigned int w0, w1;
+
+    /* Step 1: entryHI, cause, status, pc */
+    STATE_COPY_PAIR(0);
+    STATE_COPY_PAIR(2);
 
-    /* Step 1: copy all the field */
-	destination_state->s_entryHI = source_state->s_entryHI;
-	destination_state->s_cause = source_state->s_cause;
-	destination_state->s_status = source_state->s_status;
-	destination_state->s_pc = source_state->s_pc;
-
-	/* Step 2: copy the register */
-    int i;
-	for (i = 0; i < STATEREGNUM; i++){ 
-		destination_state->s_reg[i] = source_state->s_reg[i];
-	}
-}
\ No newline at end of file
+    /* Step 2: the STATEREGNUM (31) registers */
+    STATE_COPY_PAIR(4);
+    STATE_COPY_PAIR(6);
+    STATE_COPY_PAIR(8);
+    STATE_COPY_PAIR(10);
+    STATE_COPY_PAIR(12);
+    STATE_COPY_PAIR(14);
+    STATE_COPY_PAIR(16);
+    STATE_COPY_PAIR(18);
+    STATE_COPY_PAIR(20);
+    STATE_COPY_PAIR(22);
+    STATE_COPY_PAIR(24);
+    STATE_COPY_PAIR(26);
+    STATE_COPY_PAIR(28);
+    STATE_COPY_PAIR(30);
+    STATE_COPY_PAIR(32);
+    w0 = source[34];
+    destination[34] = w0;
+}
+
+#undef STATE_COPY_PAIR
+
+/**********************************************************************************************
+ * resumeContext
+ * 
+ * @brief
+ * This function resumes the current process from the exception state saved in the BIOS data page,
+ * without copying it into the pcb first: the fast return of the syscalls and interrupts that
+ * leave the current process running (see systemTrapHandler).
+ *
+ * @protocol
+ * 1. Save the current time using the system timer (STCK).
+ * 2. Load the saved exception state using LDST.
+ * 
+ * @note
+ * The p_s of the current process is then stale, it must be saved (addPigeonCurrentProcessHelper)
+ * before the process gives up the CPU.
+ * 
+ * @param void
+ * @return void
+ * **********************************************************************************************/
+void resumeContext() {
+    if (traceMask & (TRACE_SWITCH | TRACE_SYSCALL)) {
+        traceDispatchHelper(currentProcess, savedExceptionState);
+    }
+
+    /* Step 1: save the current time when return to the process */
+    STCK(start_TOD);
+
+    /* Step 2: load the saved exception state */
+    LDST(savedExceptionState);
+}
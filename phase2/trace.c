@@ -0,0 +1,399 @@
+/**********************************************************************************************
+ * trace.c
+ *
+ * @brief
+ * This file implements the kernel event trace: a fixed-size ring (traceRing) of compact
+ * binary records (trace_t), each stamped with the TOD, kept in the kernel RAM.
+ * The nucleus records:
+ *      - the context switches (switchContext),
+ *      - the syscall entries with their arguments (systemTrapHandler), and exits with their
+ *        results, when the caller runs again (traceDispatchHelper),
+ *      - the blocks on a semaphore and the unblocks (V, I/O completion, pseudo-clock, timeout),
+ *      - the interrupts and each device acknowledge,
+ *      - the debugExceptionHandler calls.
+ *
+ * Each class of events is on when its bit (TRACE_SWITCH, ...) is set in traceMask.
+ * The mask is chosen at build time (TRACE_MASK in the Makefile, which defines TRACE_DEFAULT_MASK)
+ * and changed at run time with the TRACECTL syscall, or by writing traceMask from the debugger.
+ * Every site goes through the TRACE macro (trace.h): with its class off, a record costs a single
+ * branch, so the trace can stay compiled in.
+ *
+ * With TRACE_DRAIN set in the Makefile, main also starts the drain (traceDrain): a background
+ * kernel process that streams the records to a printer or a spare terminal, so they end up in its
+ * backing file (e.g. printer0.umps), where the host tool tools/tracedump decodes them.
+ * It sleeps on a semaphore of its own between two pseudo-clock ticks (traceDrainTickHelper).
+ *
+ * @note
+ * The ring is overwritten when it is full: traceNext counts every record ever written, the last
+ * TRACE_SIZE of them are kept, the oldest at traceRing[traceNext % TRACE_SIZE].
+ *
+ * @author
+ * JaWeee Do
+ **********************************************************************************************/
+
+#include "../h/initial.h"
+#include "../h/trace.h"
+#include "../h/types.h"
+#include "../h/const.h"
+#include "../h/pcb.h"
+#include "../h/asl.h"
+#include "../h/frame.h"
+#include "../h/scheduler.h"
+#include "/usr/include/umps3/umps/libumps.h"
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------ Variables ----------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The event classes on (TRACE_SWITCH, ...) */
+int traceMask = TRACE_DEFAULT_MASK;
+
+/* The records ever written, the ring of the last TRACE_SIZE ones */
+unsigned int traceNext;
+trace_t traceRing[TRACE_SIZE];
+
+/* 1 while the drain process exists, 0 otherwise (see scheduler: alone, it is waited for) */
+int traceDrainActive;
+
+/* The drain sleeps on traceDrainSem until the next pseudo-clock tick, on the stack frame traceDrainStack */
+#if TRACE_DRAIN_LINE != 0
+HIDDEN int traceDrainSem;
+HIDDEN void *traceDrainStack;
+#endif
+
+/* The process dispatched last, so that a return to the same process is not a switch */
+HIDDEN pcb_PTR traceLast;
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* -------------------------------------------- TRACE ------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**********************************************************************************************
+ * traceHelper
+ *
+ * @brief
+ * This function writes one record on the ring, stamped with the TOD, over the oldest one
+ * when the ring is full. The sites call it through the TRACE macro, which checks the class first.
+ *
+ * @param event: TRACE_EV_...
+ * @param process: the process of the event, NULL if none
+ * @param a0 - a3: the arguments of the event
+ * @return void
+ * **********************************************************************************************/
+void traceHelper(int event, pcb_PTR process, int a0, int a1, int a2, int a3) {
+    trace_t *record = &traceRing[traceNext & (TRACE_SIZE - 1)];
+    traceNext++;
+
+    STCK(record->t_tod);
+    record->t_event = event;
+    record->t_pcb = (process == NULL) ? 0 : (memaddr) process;
+    record->t_arg[0] = a0;
+    record->t_arg[1] = a1;
+    record->t_arg[2] = a2;
+    record->t_arg[3] = a3;
+}
+
+/**********************************************************************************************
+ * traceAllHelper
+ *
+ * @brief
+ * This function records an event for every process of a queue (e.g. the pseudo-clock sleepers
+ * unblocked at once), or of its end, with its v0 as argument.
+ *
+ * @param event: TRACE_EV_...
+ * @param tp: the tail pointer of the queue
+ * @param after: the pcb the records start after, NULL to start from the head
+ * @return void
+ * **********************************************************************************************/
+void traceAllHelper(int event, pcb_PTR tp, pcb_PTR after) {
+    pcb_PTR this_pcb;
+
+    if (tp == NULL || after == tp) {
+        return;
+    }
+    this_pcb = (after == NULL) ? headProcQ(tp) : after->p_next;
+    while (TRUE) {
+        traceHelper(event, this_pcb, this_pcb->p_s.s_v0, 0, 0, 0);
+        if (this_pcb == tp) {
+            return;
+        }
+        this_pcb = this_pcb->p_next;
+    }
+}
+
+/**********************************************************************************************
+ * traceDispatchHelper
+ *
+ * @brief
+ * This function is called when a process is about to run (switchContext, resumeContext) with
+ * TRACE_SWITCH or TRACE_SYSCALL on: it records the switch if another process ran before it,
+ * and the exit of the syscall it was in, with the results it returns with.
+ *
+ * @protocol
+ * 1. If it is not the process dispatched last, record the switch
+ * 2. If it was in a syscall, record its exit (v0, v1 of the state it is loaded from)
+ *
+ * @param process: the process about to run
+ * @param state: the state it is loaded from
+ * @return void
+ * **********************************************************************************************/
+void traceDispatchHelper(pcb_PTR process, state_PTR state) {
+    /* Step 1: a switch */
+    if (process != traceLast) {
+        traceLast = process;
+        TRACE(TRACE_SWITCH, TRACE_EV_SWITCH, process, process->p_time, state->s_pc, 0, 0);
+    }
+
+    /* Step 2: a syscall exit */
+    if (process->p_traceSys != 0) {
+        TRACE(TRACE_SYSCALL, TRACE_EV_SYSRET, process, process->p_traceSys, state->s_v0, state->s_v1, 0);
+        process->p_traceSys = 0;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* -------------------------------------------- DRAIN ------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Compiled only with a drain device: without one there is no device register to poll */
+#if TRACE_DRAIN_LINE != 0
+
+/**********************************************************************************************
+ * traceWriteHelper
+ *
+ * @brief
+ * This function writes words to the drain device, one byte at a time (least significant first,
+ * as they are in memory). The drain owns the device, so it polls it with the interrupts off 
+ * and acknowledges it itself: its own I/O never reaches the nucleus, and so never floods the trace
+ * with interrupt, syscall and switch records.
+ *
+ * @protocol
+ * For each byte:
+ * 1. Turn the interrupts off
+ * 2. Issue the command (printer PRINTCHR, terminal TRANSMITCHAR) and wait while the device is BUSY
+ * 3. Acknowledge the device, so its interrupt is gone before the interrupts are turned back on
+ * 4. Turn the interrupts back on (the PLT and the other devices get in between two bytes)
+ *
+ * @param words: the words to write
+ * @param count: how many
+ * @return int: TRUE if every byte was written, FALSE on a device error
+ * **********************************************************************************************/
+HIDDEN int traceWriteHelper(int *words, int count) {
+    devregarea_t *device_register_area = (devregarea_t *) RAMBASEADDR;
+    device_t *device = &device_register_area->devreg[((TRACE_DRAIN_LINE - BASE_LINE) * DEVPERINT) + TRACE_DRAIN_DEV];
+    unsigned char *byte = (unsigned char *) words;
+    unsigned int status = getSTATUS();
+    unsigned int device_status;
+    int i;
+
+    for (i = 0; i < count * WORDLEN; i++) {
+        /* Step 1: interrupts off */
+        setSTATUS(status & ~IECON);
+
+        /* Step 2 + 3: write the byte, acknowledge */
+        if (TRACE_DRAIN_LINE == TERMINT) {
+            device->t_transm_command = PRINTCHR | (((unsigned int) byte[i]) << CHAR_SHIFT);
+            do {
+                device_status = device->t_transm_status & A8_BITS_ON;
+            } while (device_status == BUSY);
+            device->t_transm_command = ACK;
+            device_status = (device_status == CHAR_TRANSMITTED) ? READY : device_status;
+        } else {
+            device->d_data0 = byte[i];
+            device->d_command = PRINTCHR;
+            do {
+                device_status = device->d_status;
+            } while (device_status == BUSY);
+            device->d_command = ACK;
+        }
+
+        /* Step 4: interrupts back on */
+        setSTATUS(status);
+        if (device_status != READY) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**********************************************************************************************
+ * traceDrainExitHelper
+ *
+ * @brief
+ * This function terminates the drain process, giving its stack frame back to the frame pool.
+ *
+ * @protocol
+ * 1. Turn the interrupts off: nothing else runs (and may take the frame) until the drain is gone
+ * 2. Clear traceDrainActive, so the scheduler no longer waits for the drain
+ * 3. Free the stack frame and terminate (SYS2). The drain still runs on the frame until the trap,
+ *    which is safe: freeFrame only writes the first word of the frame, the stack is at the other end
+ *
+ * @param void
+ * @return void
+ * **********************************************************************************************/
+HIDDEN void traceDrainExitHelper() {
+    /* Step 1: interrupts off */
+    setSTATUS(getSTATUS() & ~IECON);
+
+    /* Step 2 + 3: gone */
+    traceDrainActive = FALSE;
+    freeFrame(traceDrainStack);
+    SYSCALL(SYS2_NUM, 0, 0, 0);
+}
+
+/**********************************************************************************************
+ * traceDrain
+ *
+ * @brief
+ * This function is the body of the drain process: it streams the trace to the drain device,
+ * then sleeps until the next pseudo-clock tick and streams what was recorded meanwhile.
+ *
+ * @protocol
+ * 1. Write the header: TRACE_MAGIC, TRACE_VERSION, TRACE_RECORD_WORDS, TRACE_SIZE
+ * 2. For each record not streamed yet, copy it with the interrupts off and write it.
+ *    If the ring went round since the last one, write a TRACE_EV_LOST record with 
+ *    the number of records lost instead, and go on from the oldest one kept
+ * 3. If the drain is the last process, terminate (the nucleus halts), otherwise P traceDrainSem,
+ *    the next pseudo-clock tick wakes it up (traceDrainTickHelper), and go back to step 2
+ *
+ * @note
+ * A device error terminates the drain. Every termination goes through traceDrainExitHelper.
+ * 
+ * The drain does not sleep on the pseudo-clock (SYS7): the I/O and pseudo-clock waiters wake up
+ * on the top MLFQ level (mlfqBlock, mlfqWakeQueue), a plain P keeps it on the lowest one.
+ *
+ * @param void
+ * @return void
+ * **********************************************************************************************/
+void traceDrain() {
+    int header[4];
+    trace_t record;
+    unsigned int drained = 0;
+    unsigned int status;
+
+    /* Step 1: the header */
+    header[0] = TRACE_MAGIC;
+    header[1] = TRACE_VERSION;
+    header[2] = TRACE_RECORD_WORDS;
+    header[3] = TRACE_SIZE;
+    if (!traceWriteHelper(header, 4)) {
+        traceDrainExitHelper();
+    }
+
+    while (TRUE) {
+        /* Step 2: the records */
+        while (drained != traceNext) {
+            status = getSTATUS();
+            setSTATUS(status & ~IECON);
+            if (traceNext - drained > TRACE_SIZE) {
+                STCK(record.t_tod);
+                record.t_event = TRACE_EV_LOST;
+                record.t_pcb = 0;
+                record.t_arg[0] = traceNext - TRACE_SIZE - drained;
+                record.t_arg[1] = record.t_arg[2] = record.t_arg[3] = 0;
+                drained = traceNext - TRACE_SIZE;
+            } else {
+                record = traceRing[drained & (TRACE_SIZE - 1)];
+                drained++;
+            }
+            setSTATUS(status);
+
+            if (!traceWriteHelper((int *) &record, TRACE_RECORD_WORDS)) {
+                traceDrainExitHelper();
+            }
+        }
+
+        /* Step 3: done, or sleep */
+        if (processCount == 1) {
+            traceDrainExitHelper();
+        }
+        SYSCALL(SYS3_NUM, (int) &traceDrainSem, 0, 0);
+    }
+}
+
+#endif
+
+/**********************************************************************************************
+ * traceDrainTickHelper
+ *
+ * @brief
+ * This function is called by the interval timer handler on every pseudo-clock tick:
+ * it wakes the drain up if it sleeps on traceDrainSem. Without a drain device, it does nothing.
+ *
+ * @protocol
+ * 1. If the drain is not asleep (traceDrainSem is not negative), nothing to do: 
+ *    the semaphore is not raised, so ticks do not pile up while it streams
+ * 2. V traceDrainSem, and make the drain ready (on its own level, see mlfqBlock)
+ *
+ * @param void
+ * @return void
+ * **********************************************************************************************/
+void traceDrainTickHelper() {
+#if TRACE_DRAIN_LINE != 0
+    pcb_PTR drain_process;
+
+    /* Step 1: awake */
+    if (traceDrainSem >= 0) {
+        return;
+    }
+
+    /* Step 2: wake it up */
+    traceDrainSem++;
+    drain_process = removeBlocked(&traceDrainSem);
+    TRACE(TRACE_BLOCK, TRACE_EV_UNBLOCK, drain_process, 0, 0, 0, 0);
+    insertReadyQueueHelper(drain_process);
+#endif
+}
+
+/**********************************************************************************************
+ * initTraceDrain
+ *
+ * @brief
+ * This function starts the drain process at boot, when TRACE_DRAIN_LINE names a device.
+ * It is a kernel mode process like the test, a background process on a stack of its own
+ * (a frame from the frame pool, given back when it terminates).
+ *
+ * @protocol
+ * 1. Nothing to do without a drain device (the drain is not even compiled)
+ * 2. Allocate the pcb and the stack frame (if either is missing, there is no drain)
+ * 3. Set its state: stack on the frame, pc on traceDrain, kernel mode with the interrupts and the PLT on
+ * 4. Place it low under every policy (see policy.c): a background process on the lowest MLFQ level,
+ *    at the lowest priority. Make it ready and count it (and flag it, for the scheduler)
+ *
+ * @param void
+ * @return void
+ * **********************************************************************************************/
+void initTraceDrain() {
+    /* Step 1: without a drain device, there is nothing to compile */
+#if TRACE_DRAIN_LINE != 0
+    pcb_PTR drain_process;
+
+    /* Step 2: pcb and stack */
+    drain_process = allocPcb();
+    if (drain_process == NULL) {
+        return;
+    }
+    traceDrainStack = allocFrame();
+    if (traceDrainStack == NULL) {
+        freePcb(drain_process);
+        return;
+    }
+
+    /* Step 3: its state */
+    drain_process->p_s.s_sp = (memaddr) traceDrainStack + PAGESIZE;
+    drain_process->p_s.s_pc = (memaddr) traceDrain;
+    drain_process->p_s.s_t9 = (memaddr) traceDrain;
+    drain_process->p_s.s_status = ALLOFF | IEPON | PLTON | IMON;
+
+    /* Step 4: low, and ready */
+    drain_process->p_background = TRUE;
+    drain_process->p_level = MLFQ_LEVELS - 1;
+    drain_process->p_priority = PRIO_LEVELS - 1;
+    insertReadyQueueHelper(drain_process);
+    processCount++;
+    traceDrainActive = TRUE;
+#endif
+}
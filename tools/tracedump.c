@@ -0,0 +1,606 @@
+/**********************************************************************************************
+ * tracedump.c
+ *
+ * @brief
+ * Host (Linux) decoder of the kernel event trace streamed by the trace drain (phase2/trace.c)
+ * to its printer or terminal backing file (e.g. printer0.umps). It prints:
+ *      - the events, one per line, with the processes named after the function they
+ *        were first dispatched at (-e),
+ *      - a timeline per process: first and last event, dispatches, CPU time, blocks, syscalls,
+ *      - the context switch rate, overall and per window (-w, a pseudo-clock tick by default),
+ *      - the run queue length over time, per window,
+ * and writes a Chrome trace (-j, open it in chrome://tracing or Perfetto).
+ * With the kernel symbol table (-s kernel.stab.umps), the pcs are shown as function+offset.
+ *
+ * usage: tracedump [-e] [-s kernel.stab.umps] [-j trace.json] [-w window_us] printer0.umps
+ *
+ * @note
+ * The stream is a header (TRACE_MAGIC, TRACE_VERSION, TRACE_RECORD_WORDS, TRACE_SIZE) then the
+ * records (trace_t), little-endian 32-bit words. The constants below mirror h/const.h,
+ * which cannot be included on the host (it redefines NULL).
+ *
+ * The run queue is rebuilt from the events: a process is ready when it is unblocked, or when
+ * another one is switched in while it runs without having blocked. A process terminated by its
+ * parent (SYS2 kills the progeny) is not seen, so the length is an estimate.
+ *
+ * @author
+ * JaWeee Do
+ **********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* h/const.h: the trace stream */
+#define TRACE_MAGIC             0x43525455
+#define TRACE_VERSION           1
+#define TRACE_ARGS              4
+#define TRACE_EV_SWITCH         1
+#define TRACE_EV_SYSCALL        2
+#define TRACE_EV_SYSRET         3
+#define TRACE_EV_BLOCK          4
+#define TRACE_EV_UNBLOCK        5
+#define TRACE_EV_INTERRUPT      6
+#define TRACE_EV_DEVICE         7
+#define TRACE_EV_DEBUG          8
+#define TRACE_EV_LOST           9
+#define SYS2_NUM                2
+#define SYSEXT_MIN_NUM          -11
+#define SYS_MAX_NUM             8
+
+#define HEADER_WORDS            4
+#define DEFAULT_WINDOW          100000      /* a pseudo-clock tick, in microseconds */
+#define MAX_PROCS               256
+#define NAME_LEN                64
+
+/* process states rebuilt from the events */
+#define ST_UNKNOWN              0
+#define ST_READY                1
+#define ST_RUNNING              2
+#define ST_BLOCKED              3
+#define ST_DEAD                 4
+
+typedef struct record_t {
+    unsigned long long r_time;      /* microseconds since the first record (TOD wraps are undone) */
+    int r_event;
+    unsigned int r_pcb;
+    int r_arg[TRACE_ARGS];
+} record_t;
+
+typedef struct symbol_t {
+    unsigned int s_addr, s_size;
+    char s_name[NAME_LEN];
+} symbol_t;
+
+typedef struct proc_t {
+    unsigned int p_pcb;
+    int p_tid;
+    char p_name[NAME_LEN];
+    int p_state;
+    unsigned long long p_first, p_last, p_runStart, p_cpu;
+    int p_dispatches, p_blocks, p_syscalls;
+    int p_sysId;                    /* Chrome async id of the syscall it is in, 0 if none */
+} proc_t;
+
+static const char *sysNames[] = {   /* SYSEXT_MIN_NUM .. SYS_MAX_NUM */
+    "TRACECTL", "IRQSTATS", "BROADCAST", "VN", "WAITANY", "TIMEDP", "TRYP",
+    "MULTICALL", "SIGNALWAIT", "SETPRIO", "SETSCHED", "?",
+    "CREATEPROCESS", "TERMINATEPROCESS", "PASSEREN", "VERHOGEN",
+    "WAITIO", "GETCPUTIME", "WAITCLOCK", "GETSUPPORTPTR"
+};
+
+static symbol_t *symbols;
+static int symbolCount;
+static proc_t procs[MAX_PROCS];
+static int procCount;
+static FILE *json;
+static int jsonFirst = 1;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------- INPUT -------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Read one little-endian word, return 0 at the end of the file */
+static int readWord(FILE *f, unsigned int *word) {
+    unsigned char b[4];
+    if (fread(b, 1, 4, f) != 4) {
+        return 0;
+    }
+    *word = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int) b[3] << 24);
+    return 1;
+}
+
+/* Skip to the header (the device file may hold something before it), and check it */
+static int readHeader(FILE *f, int *record_words) {
+    unsigned int window = 0, word;
+    int c, i;
+    unsigned int header[HEADER_WORDS];
+
+    while ((c = fgetc(f)) != EOF) {
+        window = (window >> 8) | ((unsigned int) c << 24);
+        if (window == TRACE_MAGIC) {
+            break;
+        }
+    }
+    if (c == EOF) {
+        fprintf(stderr, "tracedump: no trace header found\n");
+        return 0;
+    }
+    header[0] = TRACE_MAGIC;
+    for (i = 1; i < HEADER_WORDS; i++) {
+        if (!readWord(f, &word)) {
+            fprintf(stderr, "tracedump: truncated header\n");
+            return 0;
+        }
+        header[i] = word;
+    }
+    if (header[1] != TRACE_VERSION || header[2] < 3 + TRACE_ARGS) {
+        fprintf(stderr, "tracedump: unknown trace version %u (%u words per record)\n", header[1], header[2]);
+        return 0;
+    }
+    *record_words = header[2];
+    printf("trace: version %u, %u words per record, kernel ring of %u records\n", header[1], header[2], header[3]);
+    return 1;
+}
+
+/* Read one record, undoing the wraps of the 32-bit TOD */
+static int readRecord(FILE *f, int record_words, record_t *r) {
+    static int started = 0;
+    static unsigned int last_tod;
+    static unsigned long long now;
+    unsigned int word[16];
+    int i;
+
+    for (i = 0; i < record_words; i++) {
+        if (!readWord(f, &word[i < 16 ? i : 15])) {
+            return 0;
+        }
+    }
+    if (!started) {
+        started = 1;
+        last_tod = word[0];
+    }
+    now += (unsigned int) (word[0] - last_tod);
+    last_tod = word[0];
+
+    r->r_time = now;
+    r->r_event = (int) word[1];
+    r->r_pcb = word[2];
+    for (i = 0; i < TRACE_ARGS; i++) {
+        r->r_arg[i] = (int) word[3 + i];
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------ SYMBOLS ------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+static int compareSymbols(const void *a, const void *b) {
+    unsigned int x = ((const symbol_t *) a)->s_addr, y = ((const symbol_t *) b)->s_addr;
+    return (x > y) - (x < y);
+}
+
+/* Load the function symbols of kernel.stab.umps: each one is "name :F:0xADDRESS:0xSIZE" */
+static int loadSymbols(const char *path) {
+    FILE *f = fopen(path, "r");
+    char prev[NAME_LEN] = "", token[256];
+    char type;
+    unsigned int addr, size;
+    int capacity = 0;
+
+    if (f == NULL) {
+        perror(path);
+        return 0;
+    }
+    while (fscanf(f, "%255s", token) == 1) {
+        if (sscanf(token, ":%c:0x%x:0x%x", &type, &addr, &size) == 3) {
+            if (type == 'F' && prev[0] != '\0') {
+                if (symbolCount == capacity) {
+                    capacity = capacity ? 2 * capacity : 256;
+                    symbols = realloc(symbols, capacity * sizeof(symbol_t));
+                }
+                symbols[symbolCount].s_addr = addr;
+                symbols[symbolCount].s_size = size;
+                strcpy(symbols[symbolCount].s_name, prev);
+                symbolCount++;
+            }
+            prev[0] = '\0';
+        } else {
+            strncpy(prev, token, NAME_LEN - 1);
+            prev[NAME_LEN - 1] = '\0';
+        }
+    }
+    fclose(f);
+    qsort(symbols, symbolCount, sizeof(symbol_t), compareSymbols);
+    return 1;
+}
+
+/* function+offset of a pc, or the pc in hex */
+static const char *symbolize(unsigned int pc) {
+    static char buf[2][NAME_LEN + 16];
+    static int which;
+    int lo = 0, hi = symbolCount - 1, mid;
+    char *out = buf[which ^= 1];
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (symbols[mid].s_addr <= pc) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (hi >= 0 && pc - symbols[hi].s_addr < (symbols[hi].s_size ? symbols[hi].s_size : 1)) {
+        if (pc == symbols[hi].s_addr) {
+            snprintf(out, NAME_LEN + 16, "%s", symbols[hi].s_name);
+        } else {
+            snprintf(out, NAME_LEN + 16, "%s+0x%x", symbols[hi].s_name, pc - symbols[hi].s_addr);
+        }
+    } else {
+        snprintf(out, NAME_LEN + 16, "0x%08x", pc);
+    }
+    return out;
+}
+
+static const char *sysName(int num) {
+    if (num < SYSEXT_MIN_NUM || num > SYS_MAX_NUM) {
+        return "?";
+    }
+    return sysNames[num - SYSEXT_MIN_NUM];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ----------------------------------------- PROCESSES ------------------------------------------ */
+/* ---------------------------------------------------------------------------------------------- */
+
+static proc_t *findProc(unsigned int pcb, unsigned long long now) {
+    int i;
+    proc_t *p;
+
+    for (i = 0; i < procCount; i++) {
+        if (procs[i].p_pcb == pcb && procs[i].p_state != ST_DEAD) {
+            return &procs[i];
+        }
+    }
+    if (procCount == MAX_PROCS) {
+        fprintf(stderr, "tracedump: more than %d processes\n", MAX_PROCS);
+        exit(1);
+    }
+    p = &procs[procCount];
+    memset(p, 0, sizeof(proc_t));
+    p->p_pcb = pcb;
+    p->p_tid = ++procCount;
+    p->p_first = now;
+    snprintf(p->p_name, NAME_LEN, "pcb 0x%08x", pcb);
+    return p;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ------------------------------------------- CHROME ------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+static void jsonEvent(const char *fmt_name, const char *ph, int tid, unsigned long long ts, const char *extra) {
+    if (json == NULL) {
+        return;
+    }
+    fprintf(json, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%llu%s}",
+            jsonFirst ? "" : ",", fmt_name, ph, tid, ts, extra);
+    jsonFirst = 0;
+}
+
+/* A process stops running: charge it, and draw its run */
+static void endRun(proc_t *p, unsigned long long now) {
+    char extra[64];
+
+    p->p_cpu += now - p->p_runStart;
+    snprintf(extra, sizeof(extra), ",\"dur\":%llu", now - p->p_runStart);
+    jsonEvent("run", "X", p->p_tid, p->p_runStart, extra);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* -------------------------------------------- MAIN -------------------------------------------- */
+/* ---------------------------------------------------------------------------------------------- */
+
+/* per window: context switches, and the run queue length (time weighted sum and max) */
+typedef struct window_t {
+    int w_switches;
+    unsigned long long w_queueArea;
+    int w_queueMax;
+} window_t;
+
+static window_t *windows;
+static int windowCount;
+
+static window_t *windowAt(unsigned long long now, unsigned long long width) {
+    int w = (int) (now / width);
+    if (w >= windowCount) {
+        windows = realloc(windows, (w + 1) * sizeof(window_t));
+        memset(&windows[windowCount], 0, (w + 1 - windowCount) * sizeof(window_t));
+        windowCount = w + 1;
+    }
+    return &windows[w];
+}
+
+/* account the run queue length from *since to now, window by window */
+static void queueArea(unsigned long long *since, unsigned long long now, int length, unsigned long long width) {
+    unsigned long long end;
+    window_t *w;
+
+    while (*since < now) {
+        end = (*since / width + 1) * width;
+        if (end > now) {
+            end = now;
+        }
+        w = windowAt(*since, width);
+        w->w_queueArea += (end - *since) * length;
+        if (length > w->w_queueMax) {
+            w->w_queueMax = length;
+        }
+        *since = end;
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: tracedump [-e] [-s kernel.stab.umps] [-j trace.json] [-w window_us] tracefile\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    const char *stab = NULL, *json_path = NULL, *path = NULL;
+    unsigned long long width = DEFAULT_WINDOW, since = 0, end = 0;
+    int show_events = 0, record_words, i, queue = 0, queue_max = 0, switches = 0, lost = 0, events = 0, sys_ids = 0;
+    unsigned long long queue_total = 0;
+    proc_t *running = NULL, *p;
+    record_t r;
+    char extra[256];
+    FILE *f;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-e") == 0) {
+            show_events = 1;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            stab = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            width = strtoull(argv[++i], NULL, 0);
+            if (width == 0) {
+                usage();
+            }
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (path == NULL) {
+        usage();
+    }
+    if (stab != NULL && !loadSymbols(stab)) {
+        return 1;
+    }
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (!readHeader(f, &record_words)) {
+        return 1;
+    }
+    if (json_path != NULL) {
+        json = fopen(json_path, "w");
+        if (json == NULL) {
+            perror(json_path);
+            return 1;
+        }
+        fprintf(json, "{\"traceEvents\":[");
+        jsonEvent("process_name", "M", 0, 0, ",\"args\":{\"name\":\"uMPS3 nucleus\"}");
+        jsonEvent("thread_name", "M", 0, 0, ",\"args\":{\"name\":\"interrupts\"}");
+    }
+
+    /* Step 1: replay the events */
+    while (readRecord(f, record_words, &r)) {
+        events++;
+        queueArea(&since, r.r_time, queue, width);
+        end = r.r_time;
+        p = (r.r_pcb != 0) ? findProc(r.r_pcb, r.r_time) : NULL;
+        if (p != NULL) {
+            p->p_last = r.r_time;
+        } else if (r.r_event >= TRACE_EV_SWITCH && r.r_event <= TRACE_EV_UNBLOCK) {
+            continue;   /* these always name a process */
+        }
+
+        if (r.r_event == TRACE_EV_SWITCH && p->p_dispatches == 0) {
+            snprintf(p->p_name, NAME_LEN, "%s", symbolize((unsigned int) r.r_arg[1]));
+            if (json != NULL) {
+                snprintf(extra, sizeof(extra), ",\"args\":{\"name\":\"%s (pcb 0x%08x)\"}", p->p_name, p->p_pcb);
+                jsonEvent("thread_name", "M", p->p_tid, 0, extra);
+            }
+        }
+        if (show_events) {
+            printf("%12llu  %-24s ", r.r_time, p ? p->p_name : "-");
+        }
+        switch (r.r_event) {
+            case TRACE_EV_SWITCH:
+                if (running != NULL && running != p && running->p_state == ST_RUNNING) {
+                    endRun(running, r.r_time);
+                    running->p_state = ST_READY;
+                    queue++;
+                }
+                if (p->p_state == ST_READY) {
+                    queue--;
+                }
+                p->p_state = ST_RUNNING;
+                p->p_runStart = r.r_time;
+                p->p_dispatches++;
+                running = p;
+                switches++;
+                windowAt(r.r_time, width)->w_switches++;
+                if (show_events) {
+                    printf("SWITCH     at %s, cpu %d us\n", symbolize((unsigned int) r.r_arg[1]), r.r_arg[0]);
+                }
+                break;
+
+            case TRACE_EV_SYSCALL:
+                p->p_syscalls++;
+                p->p_sysId = ++sys_ids;
+                snprintf(extra, sizeof(extra), ",\"cat\":\"syscall\",\"id\":%d,\"args\":{\"a1\":%d,\"a2\":%d,\"a3\":%d}",
+                         p->p_sysId, r.r_arg[1], r.r_arg[2], r.r_arg[3]);
+                jsonEvent(sysName(r.r_arg[0]), "b", p->p_tid, r.r_time, extra);
+                if (show_events) {
+                    printf("SYSCALL    %s (%d) a1 0x%x a2 0x%x a3 0x%x\n", sysName(r.r_arg[0]), r.r_arg[0],
+                           r.r_arg[1], r.r_arg[2], r.r_arg[3]);
+                }
+                if (r.r_arg[0] == SYS2_NUM) {
+                    if (p->p_state == ST_RUNNING) {
+                        endRun(p, r.r_time);
+                    } else if (p->p_state == ST_READY) {
+                        queue--;
+                    }
+                    p->p_state = ST_DEAD;
+                    if (running == p) {
+                        running = NULL;
+                    }
+                }
+                break;
+
+            case TRACE_EV_SYSRET:
+                if (p->p_sysId != 0) {
+                    snprintf(extra, sizeof(extra), ",\"cat\":\"syscall\",\"id\":%d,\"args\":{\"v0\":%d,\"v1\":%d}",
+                             p->p_sysId, r.r_arg[1], r.r_arg[2]);
+                    jsonEvent(sysName(r.r_arg[0]), "e", p->p_tid, r.r_time, extra);
+                    p->p_sysId = 0;
+                }
+                if (show_events) {
+                    printf("SYSRET     %s v0 %d v1 %d\n", sysName(r.r_arg[0]), r.r_arg[1], r.r_arg[2]);
+                }
+                break;
+
+            case TRACE_EV_BLOCK:
+                if (p->p_state == ST_RUNNING) {
+                    endRun(p, r.r_time);
+                } else if (p->p_state == ST_READY) {
+                    queue--;
+                }
+                p->p_state = ST_BLOCKED;
+                p->p_blocks++;
+                if (running == p) {
+                    running = NULL;
+                }
+                snprintf(extra, sizeof(extra), ",\"s\":\"t\",\"args\":{\"semaphore\":\"0x%08x\"}", (unsigned int) r.r_arg[0]);
+                jsonEvent("block", "i", p->p_tid, r.r_time, extra);
+                if (show_events) {
+                    printf("BLOCK      on 0x%08x\n", (unsigned int) r.r_arg[0]);
+                }
+                break;
+
+            case TRACE_EV_UNBLOCK:
+                if (p->p_state != ST_READY && p->p_state != ST_RUNNING) {
+                    p->p_state = ST_READY;
+                    queue++;
+                }
+                snprintf(extra, sizeof(extra), ",\"s\":\"t\",\"args\":{\"v0\":%d}", r.r_arg[0]);
+                jsonEvent("unblock", "i", p->p_tid, r.r_time, extra);
+                if (show_events) {
+                    printf("UNBLOCK    v0 %d\n", r.r_arg[0]);
+                }
+                break;
+
+            case TRACE_EV_INTERRUPT:
+                snprintf(extra, sizeof(extra), ",\"s\":\"t\",\"args\":{\"lines\":\"0x%02x\",\"pc\":\"%s\"}",
+                         r.r_arg[0], symbolize((unsigned int) r.r_arg[2]));
+                jsonEvent("interrupt", "i", 0, r.r_time, extra);
+                if (show_events) {
+                    printf("INTERRUPT  lines 0x%02x at %s, PLT left %d\n", r.r_arg[0],
+                           symbolize((unsigned int) r.r_arg[2]), r.r_arg[1]);
+                }
+                break;
+
+            case TRACE_EV_DEVICE:
+                snprintf(extra, sizeof(extra), ",\"s\":\"t\",\"args\":{\"semaphore\":%d,\"status\":%d}", r.r_arg[0], r.r_arg[1]);
+                jsonEvent("device", "i", 0, r.r_time, extra);
+                if (show_events) {
+                    printf("DEVICE     semaphore %d status %d\n", r.r_arg[0], r.r_arg[1]);
+                }
+                break;
+
+            case TRACE_EV_DEBUG:
+                snprintf(extra, sizeof(extra), ",\"s\":\"t\",\"args\":{\"key\":%d,\"p1\":%d,\"p2\":%d,\"p3\":%d}",
+                         r.r_arg[0], r.r_arg[1], r.r_arg[2], r.r_arg[3]);
+                jsonEvent("debug", "i", p ? p->p_tid : 0, r.r_time, extra);
+                if (show_events) {
+                    printf("DEBUG      key %d: %d %d %d\n", r.r_arg[0], r.r_arg[1], r.r_arg[2], r.r_arg[3]);
+                }
+                break;
+
+            case TRACE_EV_LOST:
+                lost += r.r_arg[0];
+                snprintf(extra, sizeof(extra), ",\"s\":\"g\",\"args\":{\"records\":%d}", r.r_arg[0]);
+                jsonEvent("lost", "i", 0, r.r_time, extra);
+                if (show_events) {
+                    printf("LOST       %d records\n", r.r_arg[0]);
+                }
+                break;
+
+            default:
+                if (show_events) {
+                    printf("event %d\n", r.r_event);
+                }
+                break;
+        }
+
+        if (queue < 0) {
+            queue = 0;
+        }
+        if (queue > queue_max) {
+            queue_max = queue;
+        }
+        snprintf(extra, sizeof(extra), ",\"args\":{\"ready\":%d}", queue);
+        jsonEvent("run queue", "C", 0, r.r_time, extra);
+    }
+    fclose(f);
+
+    /* the processes still running at the end */
+    for (i = 0; i < procCount; i++) {
+        if (procs[i].p_state == ST_RUNNING) {
+            endRun(&procs[i], end);
+        }
+    }
+
+    /* Step 2: the timelines */
+    printf("\n%d events over %llu us", events, end);
+    if (lost > 0) {
+        printf(", %d records lost (the drain fell behind)", lost);
+    }
+    printf("\n\nprocesses:\n");
+    printf("  %-10s  %-28s %12s %12s %10s %12s %8s %8s\n",
+           "pcb", "name", "first us", "last us", "dispatch", "cpu us", "blocks", "syscalls");
+    for (i = 0; i < procCount; i++) {
+        p = &procs[i];
+        printf("  0x%08x  %-28s %12llu %12llu %10d %12llu %8d %8d\n", p->p_pcb, p->p_name,
+               p->p_first, p->p_last, p->p_dispatches, p->p_cpu, p->p_blocks, p->p_syscalls);
+    }
+
+    /* Step 3: the context switch rate and the run queue, per window */
+    queueArea(&since, end, queue, width);
+    for (i = 0; i < windowCount; i++) {
+        queue_total += windows[i].w_queueArea;
+    }
+    printf("\ncontext switches: %d", switches);
+    if (end > 0) {
+        printf(", %.1f per second", switches * 1000000.0 / end);
+        printf("\nrun queue: %.2f on average, %d at most", (double) queue_total / end, queue_max);
+    }
+    printf("\n\n  %12s %10s %12s %10s\n", "window us", "switches", "avg queue", "max queue");
+    for (i = 0; i < windowCount; i++) {
+        printf("  %12llu %10d %12.2f %10d\n", i * width, windows[i].w_switches,
+               (double) windows[i].w_queueArea / width, windows[i].w_queueMax);
+    }
+
+    if (json != NULL) {
+        fprintf(json, "\n]}\n");
+        fclose(json);
+    }
+    return 0;
+}